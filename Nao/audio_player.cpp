@@ -28,7 +28,7 @@ audio_player::audio_player(pcm_provider_ptr provider)
     , _device { detail::out_sample_rate, detail::sdl_out_sample_format, detail::out_channel_count,
         detail::out_buffer_size, std::bind(&audio_player::_audio_callback, this) }
     , _swr { { av_get_default_channel_layout(utils::narrow<int>(_provider->channels())),
-                av_get_packed_sample_fmt(samples::to_av(_provider->format())),
+                samples::to_av(_provider->format()),
                 utils::narrow<int>(_provider->rate())  },
             detail::output_audio } {
 
@@ -126,9 +126,19 @@ std::vector<char> audio_player::_audio_callback() {
     int64_t max_out_frames = _swr.frames_for_input(samples.frames());
     std::vector<char> result(max_out_frames * detail::out_sample_size * detail::out_channel_count);
 
-    char* in = samples.data();
+    // One pointer per plane, or a single one for interleaved samples
+    std::vector<char*> in { samples.data() };
+    if (samples::is_planar(samples.format())) {
+        size_t plane_size = samples.frames() * samples::sample_size(samples.format());
+
+        in.resize(samples.channels());
+        for (uint8_t i = 1; i < samples.channels(); ++i) {
+            in[i] = samples.data() + (i * plane_size);
+        }
+    }
+
     char* out = result.data();
-    int64_t converted = _swr.convert(&in, samples.frames(), &out, max_out_frames);
+    int64_t converted = _swr.convert(in.data(), samples.frames(), &out, max_out_frames);
 
     result.resize(converted * detail::out_sample_size * detail::out_channel_count);
 
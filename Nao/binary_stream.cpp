@@ -4,12 +4,52 @@
 
 #include <fstream>
 
+#include <emmintrin.h>
+
 #include "frameworks.h"
 
 #include "byte_array_streambuf.h"
+#include "mapped_file_streambuf.h"
+#include "partial_file_streambuf.h"
+#include "memory_streambuf.h"
 
 #include <nao/strings.h>
 
+namespace detail {
+    // Shift little-endian 64-bit words left by shift bits (1-7), filling the low bits of each
+    // word with the high bits of the word before it. Returns the last source word.
+    static uint64_t funnel_shift(const char* src, char* dst, size_t words, int shift, uint64_t prev) {
+        const __m128i left = _mm_cvtsi32_si128(shift);
+        const __m128i right = _mm_cvtsi32_si128(64 - shift);
+        __m128i carry = _mm_cvtsi64_si128(static_cast<int64_t>(prev));
+
+        size_t i = 0;
+        for (; (i + 2) <= words; i += 2) {
+            __m128i cur = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + (i * sizeof(uint64_t))));
+            __m128i last = _mm_unpacklo_epi64(carry, cur);
+
+            __m128i res = _mm_or_si128(_mm_sll_epi64(cur, left), _mm_srl_epi64(last, right));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + (i * sizeof(uint64_t))), res);
+
+            carry = _mm_unpackhi_epi64(cur, cur);
+        }
+
+        prev = static_cast<uint64_t>(_mm_cvtsi128_si64(carry));
+
+        for (; i < words; ++i) {
+            uint64_t cur;
+            memcpy(&cur, src + (i * sizeof(uint64_t)), sizeof(cur));
+
+            uint64_t res = (cur << shift) | (prev >> (64 - shift));
+            memcpy(dst + (i * sizeof(uint64_t)), &res, sizeof(res));
+
+            prev = cur;
+        }
+
+        return prev;
+    }
+}
+
 binary_istream::binary_istream(const std::string& path)
     : file { std::make_unique<std::fstream>(path, std::ios::in | std::ios::binary) } {
     
@@ -20,6 +60,20 @@ binary_istream::binary_istream(const std::filesystem::path& path)
     
 }
 
+binary_istream::binary_istream(const std::filesystem::path& path, bool mapped) {
+    if (mapped) {
+        auto buf = std::make_unique<mapped_file_streambuf>(path);
+
+        if (buf->is_open()) {
+            streambuf = std::move(buf);
+            file = std::make_shared<std::istream>(streambuf.get());
+            return;
+        }
+    }
+
+    file = std::make_unique<std::fstream>(path, std::ios::in | std::ios::binary);
+}
+
 binary_istream::binary_istream(const std::shared_ptr<std::istream>& file) : file { file } {
 
 }
@@ -52,6 +106,10 @@ binary_istream::pos_type binary_istream::tellg() const {
 class binary_istream& binary_istream::seekg(pos_type pos) {
     std::unique_lock lock(mutex);
 
+    // Any read-ahead bits are no longer valid
+    _m_bit_buffer = 0;
+    _m_bit_buffer_size = 0;
+
     if (file->eof() || !file->good()) {
         file->clear();
     }
@@ -64,6 +122,10 @@ class binary_istream& binary_istream::seekg(pos_type pos) {
 binary_istream& binary_istream::seekg(pos_type pos, seekdir dir) {
     std::unique_lock lock(mutex);
 
+    // Any read-ahead bits are no longer valid
+    _m_bit_buffer = 0;
+    _m_bit_buffer_size = 0;
+
     if (file->eof() || !file->good()) {
         file->clear();
     }
@@ -101,6 +163,30 @@ void binary_istream::clear() {
     file->clear();
 }
 
+std::streambuf* binary_istream::rdbuf() const {
+    return file->rdbuf();
+}
+
+std::span<const std::byte> binary_istream::view(std::streamoff offset, std::streamsize size) const {
+    // Ranges resolve against their root
+    if (auto partial = dynamic_cast<partial_file_streambuf*>(file->rdbuf())) {
+        if (offset < 0 || size < 0 || (offset + size) > partial->size()) {
+            return { };
+        }
+
+        return partial->root()->view(partial->start() + offset, size);
+    }
+
+    auto buf = dynamic_cast<byte_array_streambuf*>(file->rdbuf());
+
+    // A memory_streambuf may reallocate when written to, so it has no stable view
+    if (!buf || dynamic_cast<memory_streambuf*>(buf) || offset < 0 || size < 0 || static_cast<size_t>(offset + size) > buf->size()) {
+        return { };
+    }
+
+    return { reinterpret_cast<const std::byte*>(buf->data()) + offset, static_cast<size_t>(size) };
+}
+
 class binary_istream& binary_istream::rseek(pos_type pos) {
     std::unique_lock lock(mutex);
     file->seekg(pos, std::ios::cur);
@@ -108,6 +194,64 @@ class binary_istream& binary_istream::rseek(pos_type pos) {
     return *this;
 }
 
+std::streamsize binary_istream::buffer_size() const {
+    std::unique_lock lock(mutex);
+
+    if (auto partial = dynamic_cast<partial_file_streambuf*>(file->rdbuf())) {
+        return partial->buffer_size();
+    }
+
+    return 0;
+}
+
+std::streamsize binary_istream::read_at(std::streamoff offset, char* buf, std::streamsize count) const {
+    if (offset < 0 || count <= 0) {
+        return 0;
+    }
+
+    // Ranges read straight from their root, bypassing their own buffer and lock
+    if (auto partial = dynamic_cast<partial_file_streambuf*>(file->rdbuf())) {
+        if (offset >= partial->size()) {
+            return 0;
+        }
+
+        return partial->root()->read_at(partial->start() + offset, buf,
+            std::min<std::streamsize>(count, partial->size() - offset));
+    }
+
+    // Read-only memory (resources and mapped files) never changes, so no locking is needed.
+    // A memory_streambuf may be written to, so it takes the locked path below.
+    auto memory = dynamic_cast<byte_array_streambuf*>(file->rdbuf());
+    if (memory && !dynamic_cast<memory_streambuf*>(memory)) {
+        auto size = static_cast<std::streamoff>(memory->size());
+        if (offset >= size) {
+            return 0;
+        }
+
+        count = std::min<std::streamsize>(count, size - offset);
+        memcpy(buf, memory->data() + offset, count);
+
+        return count;
+    }
+
+    std::unique_lock lock(mutex);
+
+    // Restore the position and state when done
+    auto state = file->rdstate();
+    file->clear();
+    auto pos = file->tellg();
+
+    file->seekg(offset);
+    file->read(buf, count);
+    std::streamsize bytes = file->gcount();
+
+    file->clear();
+    file->seekg(pos);
+    file->setstate(state);
+
+    return bytes;
+}
+
 binary_istream& binary_istream::read(char* buf, std::streamsize count) {
     ASSERT(!_m_bitwise);
 
@@ -119,6 +263,14 @@ binary_istream& binary_istream::read(char* buf, std::streamsize count) {
 
 void binary_istream::set_bitwise(bool bitwise) {
     if (!bitwise) {
+        // Return whole bytes that were read ahead
+        std::streamoff unread = _m_bit_buffer_size / CHAR_BIT;
+        if (_m_bitwise && unread > 0) {
+            std::unique_lock lock(mutex);
+            file->clear();
+            file->seekg(-unread, std::ios::cur);
+        }
+
         _m_bit_buffer_size = 0;
         _m_bit_buffer = 0;
     }
@@ -126,35 +278,83 @@ void binary_istream::set_bitwise(bool bitwise) {
 }
 
 bool binary_istream::get_bit() {
+    return read_bits(1) != 0;
+}
+
+uintmax_t binary_istream::read_bits(size_t bits) {
     ASSERT(_m_bitwise);
+    ASSERT(bits <= bit_buffer_limit);
+
+    if (_m_bit_buffer_size < bits) {
+        _refill_bits();
+
+        if (_m_bit_buffer_size < bits) {
+            // More than 56 bits requested, or end of data
+            size_t low_bits = _m_bit_buffer_size;
+            uintmax_t low = _take_bits(low_bits);
+
+            _refill_bits();
+
+            if (_m_bit_buffer_size < (bits - low_bits)) {
+                throw std::runtime_error("no more data");
+            }
+
+            return low | (_take_bits(bits - low_bits) << low_bits);
+        }
+    }
+
+    return _take_bits(bits);
+}
+
+binary_istream& binary_istream::align() {
+    _take_bits(_m_bit_buffer_size % CHAR_BIT);
+
+    return *this;
+}
+
+void binary_istream::_refill_bits() {
+    std::streamsize bytes = (bit_buffer_limit - _m_bit_buffer_size) / CHAR_BIT;
+    if (bytes == 0) {
+        return;
+    }
+
+    uint64_t word = 0;
+
+    {
+        std::unique_lock lock(mutex);
 
-    if (_m_bit_buffer_size == 0) {
         if (file->eof()) {
-            throw std::runtime_error("no more data");
+            return;
         }
 
         if (!file->good()) {
             file->clear();
         }
 
-        _m_bit_buffer = file->get();
-        _m_bit_buffer_size = 8;
+        file->read(reinterpret_cast<char*>(&word), bytes);
+        bytes = file->gcount();
     }
 
-    --_m_bit_buffer_size;
-
-    return ((_m_bit_buffer & (0b10000000 >> _m_bit_buffer_size)) != 0);
+    _m_bit_buffer |= (word << _m_bit_buffer_size);
+    _m_bit_buffer_size += static_cast<size_t>(bytes) * CHAR_BIT;
 }
 
-uintmax_t binary_istream::read_bits(size_t bits) {
-    uintmax_t val = 0;
+uintmax_t binary_istream::_take_bits(size_t bits) {
+    if (bits == 0) {
+        return 0;
+    }
 
-    for (size_t i = 0; i < bits; ++i) {
-        if (get_bit()) {
-            val |= (1ui64 << i);
-        }
+    uint64_t val;
+    if (bits == bit_buffer_limit) {
+        val = _m_bit_buffer;
+        _m_bit_buffer = 0;
+    } else {
+        val = _m_bit_buffer & ((1ui64 << bits) - 1);
+        _m_bit_buffer >>= bits;
     }
 
+    _m_bit_buffer_size -= bits;
+
     return val;
 }
 
@@ -185,6 +385,78 @@ binary_ostream& binary_ostream::write_bits(uintmax_t val, size_t bits) {
     return *this;
 }
 
+binary_ostream& binary_ostream::append_bytes(const char* data, std::streamsize size) {
+    ASSERT(_m_bitwise);
+
+    // Write out all whole pending bytes first
+    int64_t whole = _m_bit_buffer_size / CHAR_BIT;
+    if (whole > 0) {
+        file->write(reinterpret_cast<char*>(&_m_bit_buffer), whole);
+
+        _m_bit_buffer = (whole == sizeof(_m_bit_buffer)) ? 0 : (_m_bit_buffer >> (whole * CHAR_BIT));
+        _m_bit_buffer_size -= whole * CHAR_BIT;
+    }
+
+    if (size <= 0) {
+        return *this;
+    }
+
+    int shift = static_cast<int>(_m_bit_buffer_size);
+
+    // Byte-aligned, copy directly
+    if (shift == 0) {
+        file->write(data, size);
+        return *this;
+    }
+
+    // Pending bits act as the high bits of the word before the data
+    uint64_t prev = _m_bit_buffer << (bit_buffer_limit - shift);
+
+    char chunk[4096];
+    size_t words = size / sizeof(uint64_t);
+    while (words > 0) {
+        size_t count = std::min(words, sizeof(chunk) / sizeof(uint64_t));
+        std::streamsize bytes = count * sizeof(uint64_t);
+
+        prev = detail::funnel_shift(data, chunk, count, shift, prev);
+        file->write(chunk, bytes);
+
+        data += bytes;
+        size -= bytes;
+        words -= count;
+    }
+
+    if (size > 0) {
+        uint64_t tail = 0;
+        memcpy(&tail, data, size);
+
+        uint64_t res = (tail << shift) | (prev >> (bit_buffer_limit - shift));
+        file->write(reinterpret_cast<char*>(&res), size);
+
+        // Move the last byte to the top
+        prev = tail << ((sizeof(uint64_t) - size) * CHAR_BIT);
+    }
+
+    // The high bits of the last byte remain pending
+    _m_bit_buffer = prev >> (bit_buffer_limit - shift);
+
+    return *this;
+}
+
+binary_ostream& binary_ostream::append_bits(const char* data, size_t bits) {
+    append_bytes(data, bits / CHAR_BIT);
+
+    if (size_t remainder = bits % CHAR_BIT; remainder > 0) {
+        write_bits(static_cast<uint8_t>(data[bits / CHAR_BIT]) & ((1u << remainder) - 1), remainder);
+    }
+
+    return *this;
+}
+
+size_t binary_ostream::pending_bits() const {
+    return static_cast<size_t>(_m_bit_buffer_size);
+}
+
 binary_ostream::binary_ostream(const std::filesystem::path& path)
     : file { std::make_unique<std::fstream>(path, std::ios::out | std::ios::binary) } {
 
@@ -266,3 +538,40 @@ binary_iostream::binary_iostream(const std::shared_ptr<std::iostream>& stream)
 std::iostream* binary_iostream::stream() const {
     return _m_stream.get();
 }
+
+memory_iostream::memory_iostream(std::vector<char> data)
+    : binary_iostream(std::make_shared<std::iostream>(nullptr)) {
+    auto buf = std::make_unique<memory_streambuf>(std::move(data));
+    _m_buf = buf.get();
+
+    stream()->rdbuf(_m_buf);
+    streambuf = std::move(buf);
+}
+
+char* memory_iostream::data() {
+    return _m_buf->data();
+}
+
+const char* memory_iostream::data() const {
+    return _m_buf->data();
+}
+
+size_t memory_iostream::size() const {
+    return _m_buf->size();
+}
+
+void memory_iostream::reset() {
+    ASSERT(!bitwise());
+
+    _m_buf->reset();
+    stream()->clear();
+}
+
+std::vector<char> memory_iostream::release() {
+    ASSERT(!bitwise());
+
+    auto data = _m_buf->release();
+    stream()->clear();
+
+    return data;
+}
@@ -4,6 +4,8 @@
 #include <mutex>
 #include <filesystem>
 #include <bit>
+#include <span>
+#include <vector>
 
 #include "concepts.h"
 #include "utils.h"
@@ -54,6 +56,9 @@ class binary_istream {
     explicit binary_istream(const std::string& path);
     explicit binary_istream(const std::filesystem::path& path);
 
+    // Map the file into memory if mapped is set, falls back to a regular file stream
+    binary_istream(const std::filesystem::path& path, bool mapped);
+
     // file pointer constructor
     explicit binary_istream(const std::shared_ptr<std::istream>& file);
 
@@ -81,9 +86,28 @@ class binary_istream {
 
     virtual void clear();
 
+    // Underlying stream buffer
+    std::streambuf* rdbuf() const;
+
+    // In-place view of a range of the stream, empty if the stream is not backed by contiguous memory
+    // or the range is out of bounds. Remains valid for as long as the stream exists.
+    std::span<const std::byte> view(std::streamoff offset, std::streamsize size) const;
+
     // Seek with std::ios::cur
     binary_istream& rseek(pos_type pos);
 
+    // Heap memory held by this stream's own read buffer, safe to call while others read
+    std::streamsize buffer_size() const;
+
+    // Read count bytes at offset without affecting the stream position or state, safe to call
+    // concurrently with any other function. Returns the number of bytes read.
+    virtual std::streamsize read_at(std::streamoff offset, char* buf, std::streamsize count) const;
+
+    template <concepts::readable_container Container>
+    std::streamsize read_at(std::streamoff offset, Container& buf) const {
+        return read_at(offset, reinterpret_cast<char*>(buf.data()), buf.size() * sizeof(Container::value_type));
+    }
+
     virtual binary_istream& read(char* buf, std::streamsize count);
 
     // Read count elements, each size bytes, into buf
@@ -140,21 +164,19 @@ class binary_istream {
     // Read a fixed-size integer value
     template <size_t bits>
     auto read() {
-        min_uint_t<bits> val = 0;
-
-        for (size_t i = 0; i < bits; ++i) {
-            if (get_bit()) {
-                val |= (1ui64 << i);
-            }
-        }
-
-        return val;
+        static_assert(bits <= 64);
+        return static_cast<min_uint_t<bits>>(read_bits(bits));
     }
 
-    // Read a fixed-size runtime integer value
+    // Read a fixed-size runtime integer value, up to 64 bits
     uintmax_t read_bits(size_t bits);
 
+    // Discard the remaining bits of a partially read byte
+    binary_istream& align();
+
     protected:
+    template <typename> friend class stream_cursor;
+
     // Null constructor for base classes that manually set the file pointer
     binary_istream() = default;
 
@@ -164,11 +186,17 @@ class binary_istream {
     std::unique_ptr<std::streambuf> streambuf;
 
     private:
+    // Fill the bit buffer with as many whole bytes as fit
+    void _refill_bits();
+    uintmax_t _take_bits(size_t bits);
+
     bool _m_bitwise { }; // Whether we are writing bitwise data, this must be false
                          // before next non-bitwise read
 
-    uint8_t _m_bit_buffer { };
-    uint8_t _m_bit_buffer_size { };
+    // Bits are read ahead a word at a time, unused whole bytes are returned on set_bitwise(false)
+    uint64_t _m_bit_buffer { };
+    size_t _m_bit_buffer_size { };
+    static constexpr size_t bit_buffer_limit = sizeof(_m_bit_buffer) * CHAR_BIT;
 
     static_assert(CHAR_BIT == 8);
 };
@@ -256,6 +284,15 @@ class binary_ostream {
 
     binary_ostream& write_bits(uintmax_t val, size_t bits);
 
+    // Append a span of whole bytes at the current bit position
+    binary_ostream& append_bytes(const char* data, std::streamsize size);
+
+    // Append an LSB-first bit string at the current bit position
+    binary_ostream& append_bits(const char* data, size_t bits);
+
+    // Number of bits written bitwise that are not yet in the stream
+    size_t pending_bits() const;
+
     protected:
     std::shared_ptr<std::ostream> file;
     mutable std::mutex mutex;
@@ -285,6 +322,29 @@ class binary_iostream : public binary_istream, public binary_ostream {
 
 using iostream_ptr = std::shared_ptr<binary_iostream>;
 
+class memory_streambuf;
+
+// Contiguous, growable in-memory stream
+class memory_iostream : public binary_iostream {
+    public:
+    explicit memory_iostream(std::vector<char> data = { });
+
+    char* data();
+    const char* data() const;
+    size_t size() const;
+
+    // Discard all contents and rewind, keeping the allocated capacity
+    void reset();
+
+    // Move the storage out, leaving the stream empty
+    std::vector<char> release();
+
+    private:
+    memory_streambuf* _m_buf;
+};
+
+using memory_iostream_ptr = std::shared_ptr<memory_iostream>;
+
 template <typename T>
 class bitwise_lock {
     T& _m_object;
@@ -0,0 +1,41 @@
+#include "bit_reader.h"
+
+bit_reader::bit_reader(const char* data, size_t size)
+    : _m_begin { reinterpret_cast<const uint8_t*>(data) }
+    , _m_pos { _m_begin }, _m_end { _m_begin + size } {
+
+}
+
+bit_reader& bit_reader::align() {
+    _take(_m_buffer_size % CHAR_BIT);
+
+    return *this;
+}
+
+size_t bit_reader::tell() const {
+    return (_m_pos - _m_begin) - (_m_buffer_size / CHAR_BIT);
+}
+
+size_t bit_reader::bits_left() const {
+    return ((_m_end - _m_pos) * CHAR_BIT) + _m_buffer_size;
+}
+
+void bit_reader::_refill() {
+    if ((_m_end - _m_pos) >= static_cast<std::ptrdiff_t>(sizeof(_m_buffer))) {
+        // Load a full word, only the whole bytes that fit are counted
+        uint64_t word;
+        memcpy(&word, _m_pos, sizeof(word));
+
+        _m_buffer |= (word << _m_buffer_size);
+
+        size_t bytes = (buffer_limit - _m_buffer_size) / CHAR_BIT;
+        _m_pos += bytes;
+        _m_buffer_size += bytes * CHAR_BIT;
+    } else {
+        // Near the end of the buffer
+        while ((_m_buffer_size + CHAR_BIT) <= buffer_limit && _m_pos < _m_end) {
+            _m_buffer |= (static_cast<uint64_t>(*_m_pos++) << _m_buffer_size);
+            _m_buffer_size += CHAR_BIT;
+        }
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "binary_stream.h"
+
+// Reads LSB-first bit-packed data from a contiguous buffer using a 64-bit refill register
+class bit_reader {
+    const uint8_t* _m_begin;
+    const uint8_t* _m_pos;
+    const uint8_t* _m_end;
+
+    // Bits above _m_buffer_size always mirror the bytes starting at _m_pos
+    uint64_t _m_buffer { };
+    size_t _m_buffer_size { };
+
+    static constexpr size_t buffer_limit = sizeof(_m_buffer) * CHAR_BIT;
+
+    public:
+    bit_reader(const char* data, size_t size);
+
+    template <concepts::readable_container Container>
+    explicit bit_reader(const Container& buf)
+        : bit_reader(reinterpret_cast<const char*>(buf.data()), buf.size() * sizeof(Container::value_type)) { }
+
+    // Read a fixed-size integer value
+    template <size_t bits>
+    auto read() {
+        static_assert(bits <= buffer_limit);
+        return static_cast<min_uint_t<bits>>(read_bits(bits));
+    }
+
+    // Read up to 64 bits in constant time
+    uintmax_t read_bits(size_t bits) {
+        ASSERT(bits <= buffer_limit);
+
+        if (_m_buffer_size >= bits) {
+            return _take(bits);
+        }
+
+        _refill();
+
+        if (_m_buffer_size >= bits) {
+            return _take(bits);
+        }
+
+        // More than 56 bits requested, or end of data
+        size_t low_bits = _m_buffer_size;
+        uintmax_t low = _take(low_bits);
+
+        _refill();
+
+        if (_m_buffer_size < (bits - low_bits)) {
+            throw std::runtime_error("no more data");
+        }
+
+        return low | (_take(bits - low_bits) << low_bits);
+    }
+
+    bool get_bit() {
+        return read_bits(1) != 0;
+    }
+
+    // Discard the remaining bits of a partially read byte
+    bit_reader& align();
+
+    // Number of bytes consumed, including a partially read byte
+    size_t tell() const;
+
+    // Number of bits that can still be read
+    size_t bits_left() const;
+
+    private:
+    uintmax_t _take(size_t bits) {
+        if (bits == 0) {
+            return 0;
+        }
+
+        uint64_t val;
+        if (bits == buffer_limit) {
+            val = _m_buffer;
+            _m_buffer = 0;
+        } else {
+            val = _m_buffer & ((1ui64 << bits) - 1);
+            _m_buffer >>= bits;
+        }
+
+        _m_buffer_size -= bits;
+
+        return val;
+    }
+
+    void _refill();
+};
@@ -6,14 +6,34 @@ byte_array_streambuf::byte_array_streambuf(const char* data, size_t size) {
     setg(const_cast<char*>(data), const_cast<char*>(data), const_cast<char*>(data) + size);
 }
 
+const char* byte_array_streambuf::data() const {
+    return eback();
+}
+
+size_t byte_array_streambuf::size() const {
+    return std::distance(eback(), egptr());
+}
+
+std::streamoff byte_array_streambuf::tell() const {
+    return std::distance(eback(), gptr());
+}
+
 std::streambuf::pos_type byte_array_streambuf::seekoff(off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode) {
+    char* pos;
     switch (dir) {
-        case std::ios::beg: setg(eback(), eback() + offset, egptr()); break;
-        case std::ios::cur: setg(eback(), gptr() + offset, egptr()); break;
-        case std::ios::end: setg(eback(), egptr() + offset, egptr()); break;
-        default: break;
+        case std::ios::beg: pos = eback() + offset; break;
+        case std::ios::cur: pos = gptr() + offset; break;
+        case std::ios::end: pos = egptr() + offset; break;
+        default: return pos_type(off_type(-1));
     }
 
+    // Never move outside of the buffer
+    if (pos < eback() || pos > egptr()) {
+        return pos_type(off_type(-1));
+    }
+
+    setg(eback(), pos, egptr());
+
     return std::distance(eback(), gptr());
 }
 
@@ -12,7 +12,17 @@ class byte_array_streambuf : public std::streambuf {
         byte_array_streambuf(const T* data, size_t size)
             : byte_array_streambuf(reinterpret_cast<const char*>(data), size * sizeof(std::remove_pointer_t<T>)) { }
 
+    // Direct access to the underlying buffer
+    const char* data() const;
+    size_t size() const;
+
+    // Current read position
+    std::streamoff tell() const;
+
     protected:
+    // For derived classes that set the buffer themselves
+    byte_array_streambuf() = default;
+
     pos_type seekoff(off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode) override;
     pos_type seekpos(pos_type pos, std::ios_base::openmode) override;
 };
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "binary_stream.h"
+#include "bit_reader.h"
+
+namespace wwriff {
+    // Taken from libvorbis
+    int ilog(unsigned int v);
+    long book_maptype1_quantvals(long entries, long dim);
+}
+
+class codebook_library {
+    public:
+    explicit codebook_library(const istream_ptr& codebook);
+
+    const char* get_codebook(uint32_t id) const;
+    std::streamsize get_size(uint32_t id) const;
+
+    // Number of codebook ids, valid ids are below this
+    uint32_t count() const;
+
+    bool rebuild(uint32_t id, binary_ostream& os) const;
+
+    static void rebuild(bit_reader& in, binary_ostream& out);
+
+    protected:
+    istream_ptr stream;
+
+    private:
+    // Points into the stream if it is memory-backed, otherwise into _m_data
+    const char* _m_codebooks { };
+
+    std::vector<char> _m_data;
+    std::vector<uint32_t> _m_offsets;
+    uint32_t _m_codebook_count;
+};
+
+// Codebooks expanded ahead of time by codebook-gen, written out without decoding.
+// The table starts with a uint32 count, followed by an { offset, bits } pair per codebook
+// and the LSB-first bit strings, each starting on a byte boundary.
+class rebuilt_codebook_library {
+    public:
+    explicit rebuilt_codebook_library(const istream_ptr& table);
+
+    uint32_t count() const;
+
+    bool rebuild(uint32_t id, binary_ostream& os) const;
+
+    protected:
+    istream_ptr stream;
+
+    private:
+    struct entry {
+        uint32_t offset;
+        uint32_t bits;
+    };
+
+    // Points into the stream if it is memory-backed, otherwise into _m_data
+    const char* _m_codebooks { };
+    size_t _m_size { };
+
+    std::vector<char> _m_data;
+    std::vector<entry> _m_entries;
+};
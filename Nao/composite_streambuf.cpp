@@ -0,0 +1,115 @@
+#include "composite_streambuf.h"
+
+composite_streambuf::composite_streambuf(std::vector<char> header, const istream_ptr& stream,
+    std::streamoff start, std::streamsize size)
+    : _header { std::move(header) }, _stream { stream }, _start { start }, _size { size }, _buf(buf_size) {
+    setg(_buf.data(), _buf.data(), _buf.data());
+}
+
+std::streamsize composite_streambuf::size() const {
+    return static_cast<std::streamsize>(_header.size()) + _size;
+}
+
+composite_streambuf::int_type composite_streambuf::underflow() {
+    auto cur = _cur();
+
+    if (cur >= size()) {
+        return traits_type::eof();
+    }
+
+    auto header_size = static_cast<std::streamoff>(_header.size());
+
+    if (cur < header_size) {
+        _buf_pos = 0;
+        setg(_header.data(), _header.data() + cur, _header.data() + _header.size());
+    } else {
+        auto count = std::min<std::streamsize>(size() - cur, buf_size);
+
+        // Positional read, the source stream may be shared
+        count = _stream->read_at(_start + (cur - header_size), _buf.data(), count);
+        if (count <= 0) {
+            return traits_type::eof();
+        }
+
+        _buf_pos = cur;
+        setg(_buf.data(), _buf.data(), _buf.data() + count);
+    }
+
+    return traits_type::to_int_type(*gptr());
+}
+
+std::streamsize composite_streambuf::xsgetn(char* s, std::streamsize count) {
+    std::streamsize total = 0;
+
+    // Use whatever is left in the get area first
+    std::streamsize available = std::min<std::streamsize>(egptr() - gptr(), count);
+    if (available > 0) {
+        memcpy(s, gptr(), available);
+        gbump(static_cast<int>(available));
+
+        total += available;
+    }
+
+    auto cur = _cur();
+    auto header_size = static_cast<std::streamoff>(_header.size());
+
+    // Large reads past the header go straight to the source
+    if ((count - total) >= buf_size && cur >= header_size) {
+        std::streamsize bytes = std::min<std::streamsize>(count - total, size() - cur);
+        if (bytes > 0) {
+            bytes = std::max<std::streamsize>(_stream->read_at(_start + (cur - header_size), s + total, bytes), 0);
+
+            total += bytes;
+            cur += bytes;
+        }
+
+        // Empty get area at the new position
+        _buf_pos = cur;
+        setg(_buf.data(), _buf.data(), _buf.data());
+
+        return total;
+    }
+
+    if (total == count) {
+        return total;
+    }
+
+    return total + std::streambuf::xsgetn(s + total, count - total);
+}
+
+std::streamsize composite_streambuf::showmanyc() {
+    return size() - _cur();
+}
+
+composite_streambuf::pos_type composite_streambuf::seekoff(off_type offset, std::ios::seekdir dir, std::ios::openmode mode) {
+    switch (dir) {
+        case std::ios::cur: return seekpos(_cur() + offset, mode);
+        case std::ios::beg: return seekpos(offset, mode);
+        case std::ios::end: return seekpos(size() + offset, mode);
+        default: break;
+    }
+
+    return -1;
+}
+
+composite_streambuf::pos_type composite_streambuf::seekpos(pos_type pos, std::ios::openmode) {
+    if (pos < 0 || pos > size()) {
+        return -1;
+    }
+
+    // If the new position is inside the get area
+    if (pos >= _buf_pos && pos <= (_buf_pos + std::distance(eback(), egptr()))) {
+        setg(eback(), eback() + (pos - _buf_pos), egptr());
+        return pos;
+    }
+
+    // Not inside the get area, refilled on the next read
+    _buf_pos = pos;
+    setg(_buf.data(), _buf.data(), _buf.data());
+
+    return pos;
+}
+
+std::streamoff composite_streambuf::_cur() const {
+    return _buf_pos + std::distance(eback(), gptr());
+}
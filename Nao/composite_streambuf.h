@@ -0,0 +1,38 @@
+#pragma once
+
+#include "binary_stream.h"
+
+#include <vector>
+
+// Read-only concatenation of a small in-memory header and a range of another stream.
+// Used to patch file headers without copying the data that follows them.
+class composite_streambuf : public std::streambuf {
+    static constexpr std::streamsize buf_size = 64 * 1024;
+
+    std::vector<char> _header;
+
+    // Range of the source stream following the header
+    istream_ptr _stream;
+    std::streamoff _start;
+    std::streamsize _size;
+
+    std::vector<char> _buf;
+
+    // Offset of the start of the get area
+    std::streamoff _buf_pos = 0;
+
+    public:
+    composite_streambuf(std::vector<char> header, const istream_ptr& stream, std::streamoff start, std::streamsize size);
+
+    // Combined size of the header and the range
+    std::streamsize size() const;
+
+    protected:
+    int_type underflow() override;
+    std::streamsize xsgetn(char* s, std::streamsize count) override;
+    std::streamsize showmanyc() override;
+    pos_type seekoff(off_type offset, std::ios::seekdir dir, std::ios::openmode mode) override;
+    pos_type seekpos(pos_type pos, std::ios::openmode mode) override;
+
+    std::streamoff _cur() const;
+};
@@ -1,6 +1,7 @@
 #include "ffmpeg.h"
 
 #include "utils.h"
+#include "stream_cursor.h"
 
 extern "C" {
 #include <libavformat/avformat.h>
@@ -9,17 +10,17 @@ extern "C" {
 namespace detail {
     static int read(void* opaque, uint8_t* buf, int buf_size) {
         binary_istream* stream = static_cast<binary_istream*>(opaque);
-        if (!stream->good()) {
-            return -1;
-        }
 
-        if (stream->eof()) {
-            return AVERROR_EOF;
-        }
+        // Lock the stream once for the entire callback
+        return with_cursor(*stream, [&](auto& cursor) {
+            cursor.read(buf, buf_size);
 
-        stream->read(buf, buf_size);
+            if (cursor.gcount() == 0) {
+                return AVERROR_EOF;
+            }
 
-        return utils::narrow<int>(stream->gcount());
+            return utils::narrow<int>(cursor.gcount());
+        });
     }
 
     static int64_t seek(void* opaque, int64_t offset, int whence) {
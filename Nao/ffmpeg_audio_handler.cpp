@@ -41,5 +41,6 @@ static bool supports(const istream_ptr& stream, const std::string& path) {
     .tag = TAG_PCM,
     .creator = create,
     .supports = supports,
-    .name = "ffmpeg audio"
+    .name = "ffmpeg audio",
+    .fallback = true
     });
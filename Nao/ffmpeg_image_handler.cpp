@@ -45,5 +45,6 @@ static bool supports(const istream_ptr& stream, const std::string& path) {
     .tag = TAG_IMAGE,
     .creator = create,
     .supports = supports,
-    .name = "ffmpeg image"
+    .name = "ffmpeg image",
+    .fallback = true
     });
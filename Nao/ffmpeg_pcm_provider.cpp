@@ -31,7 +31,7 @@ pcm_samples ffmpeg_pcm_provider::get_samples() {
         res = _ctx.read_frame(_packet, _stream.index());
         if (res != 0) {
             // EOF
-            return { _fmt, 0, _channels, _channel_layout };
+            return { format(), 0, _channels, _channel_layout };
         }
 
         res = _codec_ctx.decode(_packet, _frame);
@@ -43,7 +43,7 @@ pcm_samples ffmpeg_pcm_provider::get_samples() {
         _packet.unref();
     } while (res == AVERROR(EAGAIN));
 
-    pcm_samples samples { _fmt, _frame.samples(), _channels, _channel_layout };
+    pcm_samples samples { format(), _frame.samples(), _channels, _channel_layout };
 
     _samples_played += _frame.samples();
 
@@ -83,16 +83,17 @@ std::chrono::nanoseconds ffmpeg_pcm_provider::duration() {
 }
 
 std::chrono::nanoseconds ffmpeg_pcm_provider::pos() {
-    // Offset to start of data segment
-    return _samples_played * std::chrono::nanoseconds { static_cast<int64_t>((1. / _stream.sample_rate()) * 1e9) };
+    // Integer math so the position doesn't drift on long streams
+    return std::chrono::nanoseconds { (_samples_played * 1'000'000'000) / _stream.sample_rate() };
 }
 
 void ffmpeg_pcm_provider::seek(std::chrono::nanoseconds pos) {
-    _samples_played = pos / std::chrono::nanoseconds { static_cast<int64_t>((1. / _stream.sample_rate()) * 1e9) };
+    _samples_played = (pos.count() * _stream.sample_rate()) / 1'000'000'000;
 
     ASSERT(_ctx.seek(pos, _stream.index()));
 }
 
 sample_format ffmpeg_pcm_provider::format() {
-    return _fmt;
+    // Planar frames are interleaved in get_samples
+    return samples::from_av(av_get_packed_sample_fmt(samples::to_av(_fmt)));
 }
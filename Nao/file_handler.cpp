@@ -2,6 +2,16 @@
 
 #include <nao/logging.h>
 
+namespace detail {
+    static std::string index_key(std::string path) {
+        if (path.size() > 1 && path.back() == '\\') {
+            path.pop_back();
+        }
+
+        return path;
+    }
+}
+
 file_handler::~file_handler() {
     nao::coutln("[FILE] Deleting for", path);
 }
@@ -20,7 +30,7 @@ file_handler::file_handler(const istream_ptr& stream, const std::string& path)
 }
 
 size_t item_file_handler::count() const {
-    return items.size();
+    return _m_published.load(std::memory_order_acquire);
 }
 
 item_data& item_file_handler::data(size_t index) {
@@ -31,6 +41,65 @@ const std::vector<item_data>& item_file_handler::data() const {
     return items;
 }
 
+std::span<const item_data> item_file_handler::published() const {
+    // The storage never moves while populating, only the size changes
+    return { items.data(), count() };
+}
+
+size_t item_file_handler::populate(size_t max) {
+    size_t previous = count();
+
+    size_t added = populate_items(max);
+
+    // Earlier duplicates take precedence, like a linear search would
+    _m_index.reserve(items.capacity());
+    for (size_t i = previous; i < items.size(); ++i) {
+        _m_index.emplace(detail::index_key(items[i].path()), i);
+    }
+
+    _m_published.store(items.size(), std::memory_order_release);
+    _m_populated = added < max;
+
+    return items.size() - previous;
+}
+
+bool item_file_handler::populated() const {
+    return _m_populated;
+}
+
+const item_data* item_file_handler::find(const std::string& path) const {
+    if (auto it = _m_index.find(detail::index_key(path)); it != _m_index.end() && it->second < count()) {
+        return &items[it->second];
+    }
+
+    return nullptr;
+}
+
+size_t item_file_handler::memory_usage() const {
+    size_t size = sizeof(*this) + (items.capacity() * sizeof(item_data));
+
+    for (const item_data& item : published()) {
+        // Probed metadata belongs to the main thread and is left out, codec names are short anyway
+        size += item.name.capacity() + item.type.capacity() + item.size_str.capacity();
+
+        // Read-ahead buffers of streams that have been read from, usually the bulk of it
+        if (item.stream) {
+            size += static_cast<size_t>(item.stream->buffer_size());
+        }
+    }
+
+    // Rough per-node overhead of the path index
+    for (const auto& [key, index] : _m_index) {
+        size += key.capacity() + sizeof(key) + sizeof(index) + (2 * sizeof(void*));
+    }
+
+    return size;
+}
+
+size_t item_file_handler::populate_items(size_t) {
+    return 0;
+}
+
 file_handler_tag operator|(file_handler_tag left, file_handler_tag right) noexcept {
     return static_cast<file_handler_tag>(static_cast<uintmax_t>(left) | static_cast<uintmax_t>(right));
 }
@@ -5,6 +5,10 @@
 #include "pcm_provider.h"
 #include "image_provider.h"
 
+#include <atomic>
+#include <span>
+#include <unordered_map>
+
 enum file_handler_tag : uintmax_t {
     TAG_FILE  = 0b0000,
     TAG_ITEMS = 0b0001,
@@ -83,15 +87,42 @@ class item_file_handler : public virtual file_handler {
     using file_handler::file_handler;
     virtual ~item_file_handler() = default;
 
-    // Number of items to display in this item
+    // Number of items published so far
     size_t count() const;
 
     // Access item data
     item_data& data(size_t index);
     const std::vector<item_data>& data() const;
 
+    // Items published so far, safe to read from any thread while populating
+    std::span<const item_data> published() const;
+
+    // Create and publish up to max more items, returns the number of newly published items.
+    // Handlers that create every item up front publish them all on the first call.
+    size_t populate(size_t max);
+
+    // Whether every item has been published
+    bool populated() const;
+
+    // Published item with the given path, ignoring a trailing separator, or null
+    const item_data* find(const std::string& path) const;
+
+    // Approximate heap memory held by this handler, in bytes
+    virtual size_t memory_usage() const;
+
     protected:
+    // Append up to max new items, returns how many were added. Handlers that populate lazily
+    // must reserve every item up front, so published items never move.
+    virtual size_t populate_items(size_t max);
+
     std::vector<item_data> items;
+
+    private:
+    std::atomic<size_t> _m_published { };
+    std::atomic<bool> _m_populated { };
+
+    // Item index by path without trailing separator, extended on every populate
+    std::unordered_map<std::string, size_t> _m_index;
 };
 
 using item_file_handler_ptr = std::shared_ptr<item_file_handler>;
@@ -4,9 +4,50 @@
 
 #include <nao/logging.h>
 
+namespace detail {
+    static std::string lowercase_extension(const std::string& path) {
+        size_t dot = path.find_last_of('.');
+        size_t sep = path.find_last_of("\\/");
+
+        if (dot == std::string::npos || (sep != std::string::npos && dot < sep)) {
+            return { };
+        }
+
+        std::string ext = path.substr(dot);
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](char c) {
+            return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        });
+
+        return ext;
+    }
+}
+
+probe_header::probe_header(const istream_ptr& stream, const std::string& path)
+    : extension { detail::lowercase_extension(path) } {
+    if (stream) {
+        size = static_cast<size_t>(stream->read_at(0, data.data(), max_size));
+    }
+}
+
+bool probe_header::matches(const file_signature& signature) const {
+    if (signature.offset + signature.magic.size() > size) {
+        return false;
+    }
+
+    return std::equal(signature.magic.begin(), signature.magic.end(), data.begin() + signature.offset);
+}
+
 size_t file_handler_factory::register_class(const factory_entry& entry) {
     _registered_classes().emplace_back(factory_registry(entry, _next_id()));
 
+    if (entry.extensions.empty()) {
+        _any_extension().push_back(_next_id());
+    } else {
+        for (const std::string& ext : entry.extensions) {
+            _by_extension()[ext].push_back(_next_id());
+        }
+    }
+
     nao::coutln("[ITEM FACTORY] Registered class", entry.name, "with ID", _next_id());
 
     return _next_id()++;
@@ -38,7 +79,9 @@ file_handler_ptr file_handler_factory::create(const std::string& name, const ist
 }
 
 file_handler_ptr file_handler_factory::create(const istream_ptr& stream, const std::string& path) {
-    for (const factory_registry& reg : _registered_classes()) {
+    for (size_t id : _candidates(probe_header { stream, path })) {
+        const factory_registry& reg = _registered_classes()[id];
+
         // Should support this setup
         bool provider = reg.supports(stream, path);
 
@@ -61,7 +104,9 @@ file_handler_ptr file_handler_factory::create(const istream_ptr& stream, const s
 }
 
 size_t file_handler_factory::supports(const istream_ptr& stream, const std::string& path) {
-    for (const factory_registry& reg : _registered_classes()) {
+    for (size_t id : _candidates(probe_header { stream, path })) {
+        const factory_registry& reg = _registered_classes()[id];
+
         // Should support this setup
         bool supported = reg.supports(stream, path);
 
@@ -91,6 +136,40 @@ size_t file_handler_factory::supports(const istream_ptr& stream, const std::stri
     return id;
 }
 
+std::vector<size_t> file_handler_factory::_candidates(const probe_header& header) {
+    std::vector<size_t> ids = _any_extension();
+
+    if (!header.extension.empty()) {
+        if (auto it = _by_extension().find(header.extension); it != _by_extension().end()) {
+            ids.insert(ids.end(), it->second.begin(), it->second.end());
+        }
+    }
+
+    // Drop handlers whose signatures don't match, without touching the stream again
+    std::erase_if(ids, [&header](size_t id) {
+        const factory_registry& reg = _registered_classes()[id];
+
+        // Nothing to probe for an empty or missing stream
+        if (reg.fallback && header.size == 0) {
+            return true;
+        }
+
+        const auto& signatures = reg.signatures;
+
+        return !signatures.empty() && std::none_of(signatures.begin(), signatures.end(),
+            [&header](const file_signature& signature) { return header.matches(signature); });
+    });
+
+    // Registration order, with the expensive probes last
+    std::sort(ids.begin(), ids.end(), [](size_t left, size_t right) {
+        bool left_fallback = _registered_classes()[left].fallback;
+        bool right_fallback = _registered_classes()[right].fallback;
+
+        return (left_fallback != right_fallback) ? right_fallback : (left < right);
+    });
+
+    return ids;
+}
 
 file_handler_factory::factory_registry::factory_registry(const factory_entry& entry, size_t id)
     : factory_entry(entry), id(id) {
@@ -112,3 +191,13 @@ size_t& file_handler_factory::_next_id() {
     static size_t next = 0;
     return next;
 }
+
+std::unordered_map<std::string, std::vector<size_t>>& file_handler_factory::_by_extension() {
+    static std::unordered_map<std::string, std::vector<size_t>> map;
+    return map;
+}
+
+std::vector<size_t>& file_handler_factory::_any_extension() {
+    static std::vector<size_t> ids;
+    return ids;
+}
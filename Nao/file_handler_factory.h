@@ -2,7 +2,9 @@
 
 #include "file_handler.h"
 
+#include <array>
 #include <functional>
+#include <unordered_map>
 
 // Function signature for an object that creates a file_handler
 using create_func = std::function<file_handler_ptr(const istream_ptr&, const std::string&)>;
@@ -10,11 +12,41 @@ using create_func = std::function<file_handler_ptr(const istream_ptr&, const std
 // Can the provider be created for this setup
 using supports_func = std::function<bool(const istream_ptr&, const std::string&)>;
 
+// Magic bytes at a fixed offset from the start of a file
+struct file_signature {
+    size_t offset;
+    std::string magic;
+};
+
 struct factory_entry {
     file_handler_tag tag;
     create_func creator;
     supports_func supports = [](const istream_ptr&, const std::string&) { return false; };
     std::string name = "unknown";
+
+    // Lowercase extensions including the dot, supports is only called for these. Empty matches all.
+    std::vector<std::string> extensions;
+
+    // Supports is only called if any of these match, empty matches all
+    std::vector<file_signature> signatures;
+
+    // Expensive probe, only tried if no other handler supports the file
+    bool fallback = false;
+};
+
+// Start of a file, read once and shared by all handlers' dispatch checks
+struct probe_header {
+    static constexpr size_t max_size = 64;
+
+    std::array<char, max_size> data { };
+    size_t size { };
+
+    // Lowercase, including the dot
+    std::string extension;
+
+    probe_header(const istream_ptr& stream, const std::string& path);
+
+    bool matches(const file_signature& signature) const;
 };
 
 class file_handler_factory {
@@ -49,7 +81,14 @@ class file_handler_factory {
         size_t id;
     };
 
+    // Ids of handlers that may support a file, cheap probes first
+    static std::vector<size_t> _candidates(const probe_header& header);
+
     static std::vector<factory_registry>& _registered_classes();
     static size_t& _next_id();
+
+    // Dispatch tables, handlers restricted to an extension and handlers for any extension
+    static std::unordered_map<std::string, std::vector<size_t>>& _by_extension();
+    static std::vector<size_t>& _any_extension();
 };
 
@@ -70,6 +70,10 @@ namespace fs_utils {
             return utils::make_quad(_data.nFileSizeLow, _data.nFileSizeHigh);
         }
 
+        int64_t file_info::mtime() const {
+            return utils::make_quad(_data.ftLastWriteTime.dwLowDateTime, _data.ftLastWriteTime.dwHighDateTime);
+        }
+
         bool file_info::invalid() const {
             return _data.dwFileAttributes == INVALID_FILE_ATTRIBUTES;
         }
@@ -28,6 +28,9 @@ namespace fs_utils {
             const std::string& path() const;
             int64_t size() const;
 
+            // Last write time as a FILETIME value
+            int64_t mtime() const;
+
             bool invalid() const;
 
             bool archive() const;
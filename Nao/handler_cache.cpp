@@ -0,0 +1,117 @@
+#include "handler_cache.h"
+
+#include "filesystem_utils.h"
+
+#include <nao/logging.h>
+
+namespace detail {
+    // Container paths are used both with and without a trailing separator
+    static std::string key(std::string path) {
+        while (path.size() > 1 && path.back() == '\\') {
+            path.pop_back();
+        }
+
+        return path;
+    }
+}
+
+handler_cache::handler_cache(size_t budget) : _m_budget { budget } {
+
+}
+
+item_file_handler_ptr handler_cache::get(const std::string& path) {
+    auto it = _m_index.find(detail::key(path));
+    if (it == _m_index.end()) {
+        return nullptr;
+    }
+
+    // Rewritten since it was cached, the entries may have moved
+    if (it->second->identity != _identity(it->first)) {
+        nao::coutln("[CACHE] Dropping changed", it->first);
+
+        _m_usage -= it->second->size;
+        _m_entries.erase(it->second);
+        _m_index.erase(it);
+
+        return nullptr;
+    }
+
+    _m_entries.splice(_m_entries.begin(), _m_entries, it->second);
+
+    return it->second->handler;
+}
+
+void handler_cache::put(const item_file_handler_ptr& handler) {
+    size_t size = handler->memory_usage();
+
+    std::string key = detail::key(handler->get_path());
+    file_identity identity = _identity(key);
+
+    if (auto it = _m_index.find(key); it != _m_index.end()) {
+        _m_usage -= it->second->size;
+
+        it->second->handler = handler;
+        it->second->size = size;
+        it->second->identity = identity;
+
+        _m_entries.splice(_m_entries.begin(), _m_entries, it->second);
+    } else {
+        _m_entries.push_front({ handler, size, identity });
+        _m_index.emplace(std::move(key), _m_entries.begin());
+    }
+
+    _m_usage += size;
+
+    _evict();
+}
+
+void handler_cache::set_budget(size_t budget) {
+    _m_budget = budget;
+
+    _evict();
+}
+
+size_t handler_cache::budget() const {
+    return _m_budget;
+}
+
+size_t handler_cache::usage() const {
+    return _m_usage;
+}
+
+void handler_cache::clear() {
+    _m_index.clear();
+    _m_entries.clear();
+    _m_usage = 0;
+}
+
+void handler_cache::_evict() {
+    while (_m_usage > _m_budget && !_m_entries.empty()) {
+        const entry& last = _m_entries.back();
+
+        nao::coutln("[CACHE] Evicting", last.handler->get_path());
+
+        _m_usage -= last.size;
+        _m_index.erase(detail::key(last.handler->get_path()));
+        _m_entries.pop_back();
+    }
+}
+
+handler_cache::file_identity handler_cache::_identity(const std::string& path) {
+    std::string current = path;
+
+    while (!current.empty()) {
+        if (fs_utils::file_info info { current }; !info.invalid()) {
+            return { info.size(), info.mtime() };
+        }
+
+        size_t separator = current.find_last_of('\\');
+        if (separator == std::string::npos) {
+            break;
+        }
+
+        current.resize(separator);
+    }
+
+    return { -1, -1 };
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "file_handler.h"
+
+#include <list>
+#include <unordered_map>
+
+// Keeps recently left container handlers alive so revisiting them doesn't rebuild them.
+// Least recently used handlers are dropped once their combined memory usage exceeds the budget,
+// and a handler is dropped on lookup if the file it was read from changed.
+class handler_cache {
+    public:
+    explicit handler_cache(size_t budget);
+
+    // Cached handler for a path, or null. Marks it as most recently used.
+    item_file_handler_ptr get(const std::string& path);
+
+    // Insert or refresh a handler, re-measuring its memory usage
+    void put(const item_file_handler_ptr& handler);
+
+    // Drop handlers until the total fits in the new budget
+    void set_budget(size_t budget);
+
+    size_t budget() const;
+    size_t usage() const;
+
+    void clear();
+
+    private:
+    // Size and modification time of the on-disk file a container is stored in
+    struct file_identity {
+        int64_t size;
+        int64_t mtime;
+
+        bool operator==(const file_identity& other) const = default;
+    };
+
+    struct entry {
+        item_file_handler_ptr handler;
+        size_t size;
+
+        file_identity identity;
+    };
+
+    // Containers inside other containers resolve to the outermost file on disk
+    static file_identity _identity(const std::string& path);
+
+    void _evict();
+
+    size_t _m_budget;
+    size_t _m_usage { };
+
+    // Most recently used at the front
+    std::list<entry> _m_entries;
+    std::unordered_map<std::string, std::list<entry>::iterator> _m_index;
+};
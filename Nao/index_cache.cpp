@@ -0,0 +1,145 @@
+#include "index_cache.h"
+
+#include "binary_stream.h"
+#include "filesystem_utils.h"
+
+#include <nao/logging.h>
+
+#include <ShlObj.h>
+
+#include <iomanip>
+#include <sstream>
+
+namespace detail {
+    static constexpr char index_magic[4] = { 'N', 'I', 'D', 'X' };
+    static constexpr uint32_t index_version = 2;
+
+    static std::filesystem::path cache_dir() {
+        PWSTR local_app_data;
+        if (FAILED(SHGetKnownFolderPath(FOLDERID_LocalAppData, 0, nullptr, &local_app_data))) {
+            CoTaskMemFree(local_app_data);
+            return { };
+        }
+
+        std::filesystem::path dir = std::filesystem::path(local_app_data) / "Nao" / "index";
+        CoTaskMemFree(local_app_data);
+
+        return dir;
+    }
+
+    // Cache file for a path, named after its hash
+    static std::filesystem::path cache_file(const std::string& path) {
+        std::filesystem::path dir = cache_dir();
+        if (dir.empty()) {
+            return { };
+        }
+
+        std::stringstream ss;
+        ss << std::hex << std::setfill('0') << std::setw(16) << std::hash<std::string>()(path) << ".idx";
+
+        return dir / ss.str();
+    }
+}
+
+std::optional<std::vector<index_cache::entry>> index_cache::load(const std::string& path) {
+    fs_utils::file_info info { path };
+    std::filesystem::path file = detail::cache_file(path);
+
+    if (!info || file.empty() || !std::filesystem::exists(file)) {
+        return std::nullopt;
+    }
+
+    std::error_code ec;
+    auto file_size = static_cast<std::streamoff>(std::filesystem::file_size(file, ec));
+    if (ec) {
+        return std::nullopt;
+    }
+
+    binary_istream in { file };
+
+    // Lengths come from the file, which may be truncated or corrupt
+    auto fits = [&in, file_size](uint64_t bytes) {
+        std::streamoff pos = in.tellg();
+        return pos >= 0 && pos <= file_size && bytes <= static_cast<uint64_t>(file_size - pos);
+    };
+
+    char magic[4];
+    in.read(magic, sizeof(magic));
+    if (in.gcount() != sizeof(magic) || memcmp(magic, detail::index_magic, sizeof(magic)) != 0
+        || in.read<uint32_t>() != detail::index_version) {
+        return std::nullopt;
+    }
+
+    // File changed since it was indexed
+    if (in.read<int64_t>() != info.size() || in.read<int64_t>() != info.mtime()) {
+        return std::nullopt;
+    }
+
+    // The file name is a hash, so the full path is stored as well
+    uint32_t path_size = in.read<uint32_t>();
+    if (!in.good() || !fits(path_size)) {
+        return std::nullopt;
+    }
+
+    std::string stored_path(path_size, '\0');
+    in.read(stored_path);
+    if (!in.good() || stored_path != path) {
+        return std::nullopt;
+    }
+
+    uint32_t entry_count = in.read<uint32_t>();
+    if (!in.good() || !fits(uint64_t { entry_count } * sizeof(entry))) {
+        return std::nullopt;
+    }
+
+    std::vector<entry> entries(entry_count);
+    in.read(entries.data(), entries.size() * sizeof(entry));
+
+    if (in.gcount() != static_cast<std::streamsize>(entries.size() * sizeof(entry))) {
+        return std::nullopt;
+    }
+
+    return entries;
+}
+
+void index_cache::store(const std::string& path, const std::vector<entry>& entries) {
+    fs_utils::file_info info { path };
+    std::filesystem::path file = detail::cache_file(path);
+
+    if (!info || file.empty()) {
+        return;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(file.parent_path(), ec);
+    if (ec) {
+        nao::coutln("failed to create index cache directory:", ec.message());
+        return;
+    }
+
+    // Written next to the destination and renamed, so a reader never sees a partial file
+    std::filesystem::path temp = file;
+    temp += ".tmp";
+
+    {
+        binary_ostream out { temp };
+
+        out.write(detail::index_magic, sizeof(detail::index_magic));
+        out.write(detail::index_version);
+
+        out.write(info.size());
+        out.write(info.mtime());
+
+        out.write(static_cast<uint32_t>(path.size()));
+        out.write(path.data(), path.size());
+
+        out.write(static_cast<uint32_t>(entries.size()));
+        out.write(entries.data(), entries.size() * sizeof(entry));
+    }
+
+    std::filesystem::rename(temp, file, ec);
+    if (ec) {
+        nao::coutln("failed to store index for", path, ":", ec.message());
+        std::filesystem::remove(temp, ec);
+    }
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <ios>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Persistent cache of the entry tables of container files, stored under %LOCALAPPDATA%\Nao\index.
+// Entries are keyed by path and invalidated when the file's size or modification time changes.
+class index_cache {
+    public:
+    struct entry {
+        std::streamoff offset;
+        std::streamsize size;
+    };
+
+    // Cached entries for path, if they are still up to date
+    static std::optional<std::vector<entry>> load(const std::string& path);
+
+    // Replace the cached entries for path, failures are only logged
+    static void store(const std::string& path, const std::vector<entry>& entries);
+};
@@ -2,6 +2,8 @@
 
 #include "binary_stream.h"
 
+#include <chrono>
+
 class binary_istream;
 class item_file_handler;
 
@@ -26,5 +28,11 @@ struct item_data {
 
     std::shared_ptr<void> data;
 
+    // Audio metadata, filled in by the background prober. Only accessed on the main thread.
+    std::chrono::nanoseconds duration;
+    std::string codec;
+    uint32_t channels;
+    uint32_t rate;
+
     std::string path() const;
 };
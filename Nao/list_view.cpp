@@ -108,6 +108,13 @@ int list_view::add_item(const std::vector<std::string>& text, int image, void* e
     return item.iItem;
 }
 
+void list_view::set_item_text(int index, int column, const std::string& text) const {
+    ASSERT(column < column_count());
+
+    std::wstring utf16 = nao::to_utf16(text);
+    ListView_SetItemText(handle(), index, column, utf16.data());
+}
+
 int list_view::item_at(POINT pt) const {
     LVHITTESTINFO info { };
     info.pt = pt;
@@ -198,6 +205,14 @@ void list_view::clear(const std::function<void(void*)>& deleter) const {
     ListView_DeleteAllItems(handle());
 }
 
+void list_view::set_redraw(bool enabled) const {
+    (void) send_message(WM_SETREDRAW, enabled ? TRUE : FALSE, 0);
+
+    if (enabled) {
+        redraw(RDW_ERASE | RDW_FRAME | RDW_INVALIDATE | RDW_ALLCHILDREN);
+    }
+}
+
 int list_view::index_of(void* data) const {
     LVFINDINFOW find {
         .flags = LVFI_PARAM,
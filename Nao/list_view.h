@@ -47,6 +47,7 @@ class list_view : public virtual ui_element {
     void* get_item_data(int index) const;
 
     int add_item(const std::vector<std::string>& text, int image, void* extra = nullptr) const;
+    void set_item_text(int index, int column, const std::string& text) const;
 
     int item_at(POINT pt) const;
     HWND header() const;
@@ -64,6 +65,9 @@ class list_view : public virtual ui_element {
 
     void clear(const std::function<void(void*)>& deleter = { }) const;
 
+    // Suspend repainting during bulk changes, re-enabling repaints everything
+    void set_redraw(bool enabled) const;
+
     int index_of(void* data) const;
 
     int selected() const;
@@ -0,0 +1,46 @@
+#include "mapped_file_streambuf.h"
+
+mapped_file_streambuf::mapped_file_streambuf(const std::filesystem::path& path) {
+    _file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (_file == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(_file, &size) || size.QuadPart == 0) {
+        return;
+    }
+
+    _mapping = CreateFileMappingW(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!_mapping) {
+        return;
+    }
+
+    _view = MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!_view) {
+        return;
+    }
+
+    char* data = static_cast<char*>(_view);
+    setg(data, data, data + size.QuadPart);
+}
+
+mapped_file_streambuf::~mapped_file_streambuf() {
+    if (_view) {
+        UnmapViewOfFile(_view);
+    }
+
+    if (_mapping) {
+        CloseHandle(_mapping);
+    }
+
+    if (_file != INVALID_HANDLE_VALUE) {
+        CloseHandle(_file);
+    }
+}
+
+bool mapped_file_streambuf::is_open() const {
+    return _view != nullptr;
+}
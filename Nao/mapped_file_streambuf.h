@@ -0,0 +1,24 @@
+#pragma once
+
+#include "byte_array_streambuf.h"
+
+#include <filesystem>
+
+#include <Windows.h>
+
+// Read-only view of an entire file mapped into memory
+class mapped_file_streambuf : public byte_array_streambuf {
+    HANDLE _file = INVALID_HANDLE_VALUE;
+    HANDLE _mapping = nullptr;
+    void* _view = nullptr;
+
+    public:
+    explicit mapped_file_streambuf(const std::filesystem::path& path);
+    ~mapped_file_streambuf() override;
+
+    mapped_file_streambuf(const mapped_file_streambuf&) = delete;
+    mapped_file_streambuf& operator=(const mapped_file_streambuf&) = delete;
+
+    // Whether the file was mapped successfully, empty files can't be mapped
+    bool is_open() const;
+};
@@ -24,5 +24,6 @@ static bool supports(const istream_ptr& stream, const std::string& path) {
     .tag = TAG_AV,
     .creator = create,
     .supports = supports,
-    .name = "Media Foundation"
+    .name = "Media Foundation",
+    .extensions = { ".ts", ".mpeg", ".mp4" }
     });
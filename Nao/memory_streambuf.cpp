@@ -0,0 +1,99 @@
+#include "memory_streambuf.h"
+
+#include <cstring>
+
+memory_streambuf::memory_streambuf(std::vector<char> data)
+    : _data { std::move(data) } {
+    _update_get(0);
+}
+
+char* memory_streambuf::data() {
+    return _data.data();
+}
+
+const char* memory_streambuf::data() const {
+    return _data.data();
+}
+
+size_t memory_streambuf::size() const {
+    return _data.size();
+}
+
+void memory_streambuf::reset() {
+    _data.clear();
+    _put = 0;
+
+    _update_get(0);
+}
+
+std::vector<char> memory_streambuf::release() {
+    std::vector<char> data = std::move(_data);
+    _data = { };
+    _put = 0;
+
+    _update_get(0);
+
+    return data;
+}
+
+memory_streambuf::int_type memory_streambuf::overflow(int_type c) {
+    if (traits_type::eq_int_type(c, traits_type::eof())) {
+        return traits_type::not_eof(c);
+    }
+
+    char ch = traits_type::to_char_type(c);
+    xsputn(&ch, 1);
+
+    return c;
+}
+
+std::streamsize memory_streambuf::xsputn(const char* s, std::streamsize count) {
+    if (count <= 0) {
+        return 0;
+    }
+
+    std::streamoff get_pos = tell();
+
+    size_t end = static_cast<size_t>(_put + count);
+    if (end > _data.size()) {
+        _data.resize(end);
+    }
+
+    memcpy(_data.data() + _put, s, count);
+    _put = end;
+
+    _update_get(get_pos);
+
+    return count;
+}
+
+memory_streambuf::pos_type memory_streambuf::seekoff(off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+    pos_type result = pos_type(off_type(-1));
+
+    if (which & std::ios::in) {
+        result = byte_array_streambuf::seekoff(offset, dir, which);
+    }
+
+    if (which & std::ios::out) {
+        std::streamoff pos;
+        switch (dir) {
+            case std::ios::beg: pos = offset; break;
+            case std::ios::cur: pos = _put + offset; break;
+            case std::ios::end: pos = static_cast<std::streamoff>(_data.size()) + offset; break;
+            default: return pos_type(off_type(-1));
+        }
+
+        if (pos < 0 || pos > static_cast<std::streamoff>(_data.size())) {
+            return pos_type(off_type(-1));
+        }
+
+        _put = pos;
+        result = pos;
+    }
+
+    return result;
+}
+
+void memory_streambuf::_update_get(std::streamoff pos) {
+    setg(_data.data(), _data.data() + pos, _data.data() + _data.size());
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "byte_array_streambuf.h"
+
+#include <vector>
+
+// Growable, vector-backed read/write buffer. The get area always spans all written data.
+// Not safe to write to while other threads are reading.
+class memory_streambuf : public byte_array_streambuf {
+    std::vector<char> _data;
+
+    // Write position
+    std::streamoff _put { };
+
+    public:
+    explicit memory_streambuf(std::vector<char> data = { });
+
+    char* data();
+    const char* data() const;
+    size_t size() const;
+
+    // Discard all contents, keeping the allocated capacity
+    void reset();
+
+    // Move the storage out, leaving the buffer empty
+    std::vector<char> release();
+
+    protected:
+    int_type overflow(int_type c) override;
+    std::streamsize xsputn(const char* s, std::streamsize count) override;
+    pos_type seekoff(off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+
+    private:
+    // Point the get area at the current storage, keeping the read position
+    void _update_get(std::streamoff pos);
+};
@@ -0,0 +1,179 @@
+#include "metadata_prober.h"
+
+#include "partial_file_streambuf.h"
+#include "riff.h"
+#include "thread_pool.h"
+#include "wwriff.h"
+
+namespace detail {
+    static std::chrono::nanoseconds duration(int64_t samples, uint32_t rate) {
+        if (rate == 0) {
+            return std::chrono::nanoseconds { 0 };
+        }
+
+        return std::chrono::nanoseconds { (samples * 1'000'000'000) / rate };
+    }
+}
+
+metadata_prober::metadata_prober(callback on_result) : _on_result { std::move(on_result) } {
+
+}
+
+metadata_prober::~metadata_prober() {
+    cancel();
+
+    // Queued tasks still run, but return as soon as they see the new generation
+    std::unique_lock lock(_mutex);
+    _idle.wait(lock, [this] { return _pending == 0; });
+}
+
+void metadata_prober::probe(const item_file_handler_ptr& provider, size_t first) {
+    uint64_t generation = _generation;
+
+    struct work_item {
+        const item_data* item;
+        istream_ptr stream;
+        std::streamsize size;
+    };
+
+    std::vector<work_item> work;
+
+    auto submit = [this, generation, &provider, &work] {
+        {
+            std::unique_lock lock(_mutex);
+            ++_pending;
+        }
+
+        thread_pool::shared().push([this, generation, provider, work = std::move(work)] {
+            struct task_guard {
+                metadata_prober* prober;
+                ~task_guard() { prober->_finish_task(); }
+            } guard { this };
+
+            std::vector<result> results;
+
+            for (const work_item& item : work) {
+                // Directory changed, nobody is interested anymore
+                if (_generation != generation) {
+                    return;
+                }
+
+                try {
+                    if (auto metadata = probe(item.stream, item.size)) {
+                        results.push_back({ provider, item.item, std::move(*metadata) });
+                    }
+                } catch (const std::exception& e) {
+                    nao::coutln("failed to probe", item.item->name, ":", e.what());
+                }
+            }
+
+            if (!results.empty() && _generation == generation) {
+                _on_result(std::move(results));
+            }
+        });
+
+        work.clear();
+    };
+
+    std::span<const item_data> items = provider->published();
+
+    for (size_t i = first; i < items.size(); ++i) {
+        // Only items with a stream are probed, anything else would need to be opened first
+        if (items[i].dir || !items[i].stream) {
+            continue;
+        }
+
+        work.push_back({ &items[i], items[i].stream, items[i].size });
+
+        if (work.size() == items_per_task) {
+            submit();
+        }
+    }
+
+    if (!work.empty()) {
+        submit();
+    }
+}
+
+void metadata_prober::cancel() {
+    ++_generation;
+}
+
+void metadata_prober::_finish_task() {
+    std::unique_lock lock(_mutex);
+
+    if (--_pending == 0) {
+        _idle.notify_all();
+    }
+}
+
+std::optional<item_metadata> metadata_prober::probe(const istream_ptr& stream, std::streamsize size) {
+    // Own view of the stream, it is read without its lock while others may be using it
+    auto in = std::make_shared<binary_istream>(std::make_unique<partial_file_streambuf>(stream, 0, size));
+
+    riff_header riff;
+    wave_chunk wave;
+    if (in->read_at(0, reinterpret_cast<char*>(&riff), sizeof(riff)) != sizeof(riff)
+        || in->read_at(sizeof(riff), reinterpret_cast<char*>(&wave), sizeof(wave)) != sizeof(wave)
+        || memcmp(riff.header, "RIFF", 4) != 0 || memcmp(wave.wave, "WAVE", 4) != 0) {
+        return std::nullopt;
+    }
+
+    // Find the fmt and data chunks
+    std::optional<fmt_chunk> fmt;
+    std::streamsize data_size = -1;
+
+    std::streamoff offset = sizeof(riff) + sizeof(wave);
+    riff_header chunk;
+    while ((!fmt || data_size < 0) && in->read_at(offset, reinterpret_cast<char*>(&chunk), sizeof(chunk)) == sizeof(chunk)) {
+        if (memcmp(chunk.header, "fmt ", 4) == 0) {
+            fmt_chunk f;
+            if (in->read_at(offset + sizeof(chunk), reinterpret_cast<char*>(&f), sizeof(f)) != sizeof(f)) {
+                return std::nullopt;
+            }
+
+            fmt = f;
+        } else if (memcmp(chunk.header, "data", 4) == 0) {
+            data_size = chunk.size;
+        }
+
+        offset += sizeof(chunk) + chunk.size;
+    }
+
+    if (!fmt) {
+        return std::nullopt;
+    }
+
+    switch (fmt->format) {
+        case 0xFFFF: {
+            // Sample count is stored in the vorb chunk, no packets are read
+            wwriff_converter converter { in };
+            if (!converter.parse_info()) {
+                return std::nullopt;
+            }
+
+            return item_metadata {
+                .duration = detail::duration(converter.header_sample_count(), converter.rate()),
+                .codec = "Wwise Vorbis",
+                .channels = converter.channels(),
+                .rate = converter.rate()
+            };
+        }
+
+        case 0x0001:
+        case 0xFFFE: {
+            if (data_size < 0 || fmt->align == 0) {
+                return std::nullopt;
+            }
+
+            return item_metadata {
+                .duration = detail::duration(data_size / fmt->align, fmt->rate),
+                .codec = "PCM " + std::to_string(fmt->bits) + "-bit",
+                .channels = fmt->channels,
+                .rate = fmt->rate
+            };
+        }
+
+        default: return std::nullopt;
+    }
+}
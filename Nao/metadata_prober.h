@@ -0,0 +1,63 @@
+#pragma once
+
+#include "file_handler.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
+
+struct item_metadata {
+    std::chrono::nanoseconds duration;
+    std::string codec;
+    uint32_t channels;
+    uint32_t rate;
+};
+
+// Reads audio metadata of items on a thread pool, straight from their headers without decoding
+class metadata_prober {
+    // Items probed by a single task, results are reported per task
+    static constexpr size_t items_per_task = 64;
+
+    public:
+    struct result {
+        // Provider the item was published by, which may no longer be shown
+        item_file_handler_ptr provider;
+        const item_data* item;
+
+        item_metadata metadata;
+    };
+
+    // Called from worker threads with the results of one task
+    using callback = std::function<void(std::vector<result>)>;
+
+    explicit metadata_prober(callback on_result);
+
+    // Cancels all work and waits for running tasks, so none of them outlive the callback
+    ~metadata_prober();
+
+    metadata_prober(const metadata_prober&) = delete;
+    metadata_prober& operator=(const metadata_prober&) = delete;
+
+    // Probe the provider's published items from first onwards in the background
+    void probe(const item_file_handler_ptr& provider, size_t first);
+
+    // Drop all pending work
+    void cancel();
+
+    // Metadata of a single stream, if it is a supported format
+    static std::optional<item_metadata> probe(const istream_ptr& stream, std::streamsize size);
+
+    private:
+    void _finish_task();
+
+    callback _on_result;
+
+    std::atomic<uint64_t> _generation { };
+
+    // Tasks submitted to the pool that have not finished yet
+    std::mutex _mutex;
+    std::condition_variable _idle;
+    size_t _pending { };
+};
@@ -16,12 +16,14 @@ list_view_row nao_controller::transform_data_to_row(const item_data& data) {
         .type = data.type,
         .size = (!data.dir && data.size_str.empty()) ? std::string{nao::bytes(data.size).c_str()} : data.size_str,
         .compressed = (data.compression == 0.) ? "" : (std::to_string(int64_t(data.compression / 100.)) + '%'),
+        .duration = (data.duration.count() == 0) ? "" : std::string { nao::time_minutes(data.duration.count(), false).c_str() },
+        .codec = data.codec,
         .icon = data.icon,
         .data = const_cast<item_data*>(&data)
     };
 }
 
-std::vector<list_view_row> nao_controller::transform_data_to_row(const std::vector<item_data>& data) {
+std::vector<list_view_row> nao_controller::transform_data_to_row(std::span<const item_data> data) {
     std::vector<list_view_row> list_data(data.size());
 
     std::transform(data.begin(), data.end(), list_data.begin(),
@@ -202,6 +204,22 @@ int nao_controller::order_items(item_data* first, item_data* second, data_key ke
 
             return (first->compression < second->compression) ? first1 : first2;
 
+        case KEY_DURATION: // Playback duration
+            if (first->duration == second->duration) {
+                // Fallback on name
+                return cmp(first->name, second->name);
+            }
+
+            return (first->duration < second->duration) ? first1 : first2;
+
+        case KEY_CODEC: // Codec, alphabetically
+            if (first->codec == second->codec) {
+                // Fallback on name
+                return cmp(first->name, second->name);
+            }
+
+            return cmp(first->codec, second->codec);
+
         default: return 0;
     }
 }
@@ -243,16 +261,8 @@ void nao_controller::create_context_menu(item_data* data, POINT pt) {
 
             // If the parent provider points to an existing path
             if (p != nullptr && !fs_utils::file_info(p->get_path()).invalid()) {
-                auto current_path = model.current_path();
-                const auto& d = p->data();
-
-                auto search_func = [&current_path](const item_data& data) {
-                    return fs_utils::same_path(data.path(), current_path);
-                };
-
-                if (auto it = std::find_if(d.begin(), d.end(), search_func);
-                    it != d.end()) {
-                    data = const_cast<item_data*>(&(*it));
+                if (const item_data* found = p->find(model.current_path())) {
+                    data = const_cast<item_data*>(found);
                 } else {
                     throw std::runtime_error("parent element not child of parent");
                 }
@@ -319,10 +329,28 @@ void nao_controller::move_to(const std::string& to) {
 void nao_controller::_handle_message(nao_thread_message msg, WPARAM wparam, LPARAM lparam) {
     switch (msg) {
         //// Begin model messages
-        case TM_CONTENTS_CHANGED:
-            _refresh_view(lparam);
+        case TM_CONTENTS_CHANGED: {
+            auto provider = reinterpret_cast<item_file_handler_ptr*>(wparam);
+
+            _refresh_view(*provider, lparam);
+
+            delete provider;
+            break;
+        }
+
+        case TM_CONTENTS_APPENDED:
+            _append_view(reinterpret_cast<item_file_handler*>(wparam), static_cast<size_t>(lparam));
             break;
 
+        case TM_METADATA_PROBED: {
+            auto results = reinterpret_cast<std::vector<metadata_prober::result>*>(lparam);
+
+            _update_metadata(*results);
+
+            delete results;
+            break;
+        }
+
         case TM_PREVIEW_CHANGED:
             _refresh_preview(reinterpret_cast<item_data*>(wparam), reinterpret_cast<void*>(lparam));
             break;
@@ -346,7 +374,7 @@ void nao_controller::_handle_message(nao_thread_message msg, WPARAM wparam, LPAR
     }
 }
 
-void nao_controller::_refresh_view(LPARAM lparam) {
+void nao_controller::_refresh_view(const item_file_handler_ptr& provider, LPARAM lparam) {
     (void) this;
 
     view.set_path(model.current_path());
@@ -354,16 +382,68 @@ void nao_controller::_refresh_view(LPARAM lparam) {
     view.clear_view();
     view.clear_preview();
 
-    const item_file_handler_ptr& p = model.current_provider();
-    const auto& data = p->data();
+    _m_shown = provider;
+
+    // The provider may still be populating, only show what was published so far
+    std::span<const item_data> data = _m_shown->published();
 
     view.fill_view(transform_data_to_row(data));
+    _m_rows_shown = data.size();
 
     if (lparam != 0) {
         view.select(reinterpret_cast<void*>(lparam));
     }
 }
 
+void nao_controller::_append_view(const item_file_handler* provider, size_t last) {
+    // Published by a provider that has been navigated away from, the pointer is only compared
+    if (provider != _m_shown.get()) {
+        return;
+    }
+
+    std::span<const item_data> data = _m_shown->published();
+
+    // Items published before the last refresh are already shown
+    size_t first = _m_rows_shown;
+    last = std::min(last, data.size());
+
+    if (first >= last) {
+        return;
+    }
+
+    view.append_view(transform_data_to_row(data.subspan(first, last - first)));
+    _m_rows_shown = last;
+}
+
+void nao_controller::_update_metadata(const std::vector<metadata_prober::result>& results) {
+    if (!_m_shown) {
+        return;
+    }
+
+    std::span<const item_data> data = _m_shown->published();
+
+    std::vector<list_view_row> rows;
+    rows.reserve(results.size());
+
+    for (const auto& [provider, probed, metadata] : results) {
+        // Probed for a provider that has been navigated away from
+        if (provider != _m_shown || probed < data.data() || probed >= (data.data() + data.size())) {
+            continue;
+        }
+
+        // Only ever accessed on the main thread
+        item_data& item = const_cast<item_data&>(*probed);
+        item.duration = metadata.duration;
+        item.codec = metadata.codec;
+        item.channels = metadata.channels;
+        item.rate = metadata.rate;
+
+        rows.push_back(transform_data_to_row(item));
+    }
+
+    view.update_items(rows);
+}
+
 void nao_controller::_refresh_preview(item_data* data, void* lparam) {
     const file_handler_ptr& pv = model.preview_provider();
 
@@ -16,9 +16,18 @@ enum nao_thread_message : unsigned {
     TM_MODEL_FIRST,
 
     // Model view contents changed.
+    // WPARAM: item_file_handler_ptr* of the new provider that should be deleted,
     // LPARAM: item_data* to select, or nullptr
     TM_CONTENTS_CHANGED,
 
+    // Items were published to a provider, which may no longer be the one shown.
+    // WPARAM: item_file_handler* that published them, LPARAM: index past the last new item
+    TM_CONTENTS_APPENDED,
+
+    // Metadata of items is available, possibly for a provider that is no longer shown.
+    // LPARAM: std::vector<metadata_prober::result>* that should be deleted
+    TM_METADATA_PROBED,
+
     // Preview has changed, fetch new preview
     TM_PREVIEW_CHANGED,
 
@@ -66,7 +75,7 @@ class nao_controller {
 
     // Transforms an item_data to a list_view_row
     static list_view_row transform_data_to_row(const item_data& data);
-    static std::vector<list_view_row> transform_data_to_row(const std::vector<item_data>& data);
+    static std::vector<list_view_row> transform_data_to_row(std::span<const item_data> data);
 
     explicit nao_controller();
     ~nao_controller() = default;
@@ -105,8 +114,14 @@ class nao_controller {
     // Handle custom messages on the main thread
     void _handle_message(nao_thread_message msg, WPARAM wparam, LPARAM lparam);
 
-    // Retrieve the current provider and fill the view from that
-    void _refresh_view(LPARAM lparam);
+    // Show the given provider and fill the view from that
+    void _refresh_view(const item_file_handler_ptr& provider, LPARAM lparam);
+
+    // Add newly published items of the shown provider to the view
+    void _append_view(const item_file_handler* provider, size_t last);
+
+    // Store probed metadata in the shown provider's items and update their rows
+    void _update_metadata(const std::vector<metadata_prober::result>& results);
 
     // Retrieve the current preview provider and item and display it
     void _refresh_preview(item_data* data, void* lparam);
@@ -118,6 +133,13 @@ class nao_controller {
     private:
     thread_pool _m_worker;
 
+    // Provider whose items are in the view, only accessed on the main thread.
+    // The model's tree may already have moved on while its messages are pending.
+    item_file_handler_ptr _m_shown;
+
+    // Items of the shown provider that are in the view
+    size_t _m_rows_shown { };
+
     const DWORD _m_main_threadid;
 };
 
@@ -10,9 +10,19 @@
 #include <filesystem>
 
 #include <nao/logging.h>
+#include <nao/strings.h>
 #include <nao/steam.h>
 
-nao_model::nao_model(nao_view& view, nao_controller& controller) : view(view), controller(controller) {
+bool nao_model::probe_identity::operator==(const probe_identity& other) const {
+    // Same control block, which the cache keeps alive so it is never reused by another stream
+    return size == other.size && mtime == other.mtime
+        && !stream.owner_before(other.stream) && !other.stream.owner_before(stream);
+}
+
+nao_model::nao_model(nao_view& view, nao_controller& controller) : view(view), controller(controller)
+    , _m_prober { [&controller](std::vector<metadata_prober::result> results) {
+        controller.post_message(TM_METADATA_PROBED, nullptr, new std::vector<metadata_prober::result>(std::move(results)));
+    } } {
 
 }
 
@@ -54,17 +64,11 @@ void nao_model::move_to(std::string path) {
 
                 // If a preview is shown
                 if (_m_preview_provider && _m_preview_provider->tag() & TAG_ITEMS) {
-                    const std::vector<item_data>& items = _m_preview_provider->query<TAG_ITEMS>()->data();
-
-                    auto find_func = [&path](const item_data& data) {
-                        return fs_utils::same_path(data.path(), path);
-                    };
-
-                    auto it = std::find_if(items.begin(), items.end(), find_func);
+                    const item_data* found = _m_preview_provider->query<TAG_ITEMS>()->find(path);
 
                     // And the target item is an element of the preview
-                    if (it != items.end()) {
-                        item = &(*it);
+                    if (found) {
+                        item = found;
                         path = _m_preview_provider->get_path();
 
                         if (path.back() != '\\') {
@@ -82,11 +86,24 @@ void nao_model::move_to(std::string path) {
 
     nao::coutln("move from", old_path, "to", path);
 
+    // Results for the previous directory are no longer needed
+    _m_prober.cancel();
+
     _create_tree(path);
 
     _m_path = path;
-    
-    controller.post_message(TM_CONTENTS_CHANGED, nullptr, const_cast<item_data*>(item));
+
+    // Show the first rows right away, the rest is appended as it becomes available
+    const item_file_handler_ptr& current = _m_tree.back();
+    current->populate(populate_batch_size);
+
+    controller.post_message(TM_CONTENTS_CHANGED, new item_file_handler_ptr(current), const_cast<item_data*>(item));
+
+    _m_prober.probe(current, 0);
+
+    if (!current->populated()) {
+        controller.post_work(std::bind(&nao_model::_populate, this, current));
+    }
 }
 
 void nao_model::move_up() {
@@ -105,19 +122,34 @@ void nao_model::move_down(item_data* to) {
     move_to(to->path());
 }
 
+void nao_model::_populate(const item_file_handler_ptr& provider) {
+    // Moved somewhere else in the meantime
+    if (_m_tree.empty() || _m_tree.back() != provider) {
+        return;
+    }
+
+    size_t first = provider->count();
+    size_t added = provider->populate(populate_batch_size);
+
+    if (added > 0) {
+        controller.post_message(TM_CONTENTS_APPENDED, provider.get(), reinterpret_cast<void*>(first + added));
+
+        _m_prober.probe(provider, first);
+    }
+
+    // Queued behind anything else so the UI stays responsive
+    if (!provider->populated()) {
+        controller.post_work(std::bind(&nao_model::_populate, this, provider));
+    }
+}
+
 void nao_model::fetch_preview(item_data* item) {
     // Do nothing if preview is already shown
     if (_m_preview_provider && _m_preview_provider->get_path() == item->path()) {
         return;
     }
 
-    const std::vector<item_data>& items = _m_tree.back()->data();
-
-    auto find_func = [&item](const item_data& data) {
-        return item == &data;
-    };
-
-    if (std::find_if(items.begin(), items.end(), find_func) == items.end()) {
+    if (_m_tree.back()->find(item->path()) != item) {
         throw std::runtime_error("element not child of current provider");
     }
 
@@ -134,6 +166,11 @@ void nao_model::fetch_preview(item_data* item) {
 
         file_handler_tag tag = _m_preview_provider->tag();
 
+        // Previews are shown all at once
+        if (tag & TAG_ITEMS) {
+            _m_preview_provider->query<TAG_ITEMS>()->populate(std::numeric_limits<size_t>::max());
+        }
+
         if (tag & TAG_PCM) {
             lparam = new audio_player(_m_preview_provider->query<TAG_PCM>()->make_provider());
         } else if (tag & TAG_IMAGE) {
@@ -199,6 +236,36 @@ bool nao_model::has_preview(item_data* data) {
 }
 
 
+size_t nao_model::_probe(const std::string& path, const probe_identity& identity,
+    const std::function<std::optional<istream_ptr>()>& open, file_handler_tag& tag) {
+    if (auto it = _m_probe_cache.find(path); it != _m_probe_cache.end()) {
+        if (it->second.identity == identity) {
+            tag = it->second.tag;
+            return it->second.id;
+        }
+
+        _m_probe_cache.erase(it);
+    }
+
+    auto stream = open();
+
+    // Not cached, it may be readable next time
+    if (!stream) {
+        return file_handler_factory::npos;
+    }
+
+    tag = TAG_FILE;
+    size_t id = file_handler_factory::supports(*stream, path, tag);
+
+    if (_m_probe_cache.size() >= max_cached_probes) {
+        _m_probe_cache.clear();
+    }
+
+    _m_probe_cache.emplace(path, cached_probe { identity, id, tag });
+
+    return id;
+}
+
 void nao_model::_create_tree(const std::string& to) {
     // Modify the current tree to match the supplied path
 
@@ -218,6 +285,11 @@ void nao_model::_create_tree(const std::string& to) {
             break;
         }
 
+        // Containers are kept around in case we come back, directories are cheap to list again
+        if (p->get_stream()) {
+            _m_handler_cache.put(p);
+        }
+
         _m_tree.pop_back();
     }
 
@@ -232,6 +304,9 @@ void nao_model::_create_tree(const std::string& to) {
     }
 
     while (current_path != to) {
+        // Children are looked up in the parent's items, so it must be complete
+        _m_tree.back()->populate(std::numeric_limits<size_t>::max());
+
         // Construct the path for the next element from the target path
         current_path = to.substr(0, to.find_first_of('\\', current_path.size() + 1) + 1);
 
@@ -295,6 +370,11 @@ file_handler_ptr nao_model::_provider_for(std::string path, bool* result, file_h
         }
     }
 
+    // Or was visited recently
+    if (item_file_handler_ptr p = _m_handler_cache.get(path); p != nullptr) {
+        return retval(p);
+    }
+
     fs_utils::file_info info(path);
 
     // If the path was not found
@@ -312,21 +392,13 @@ file_handler_ptr nao_model::_provider_for(std::string path, bool* result, file_h
 
     if (info.invalid()) {
         // Virtual (in-archive) file
-        const std::vector<item_data>& items = _m_tree.back()->data();
+        const item_data* found = _m_tree.back()->find(path);
 
-        auto find_func = [&path](const item_data& data) {
-            return data.path() == path;
-        };
-
-        auto it = std::find_if(items.begin(), items.end(), find_func);
-
-        if (it == items.end()) {
+        if (!found) {
             if (_m_preview_provider && _m_preview_provider->tag() & TAG_ITEMS) {
-                const auto& items1 = _m_preview_provider->query<TAG_ITEMS>()->data();
-
-                it = std::find_if(items1.begin(), items1.end(), find_func);
+                found = _m_preview_provider->query<TAG_ITEMS>()->find(path);
 
-                if (it == items1.end()) {
+                if (!found) {
                     throw std::runtime_error("element not child of current or preview provider");
                 }
             } else {
@@ -334,9 +406,11 @@ file_handler_ptr nao_model::_provider_for(std::string path, bool* result, file_h
             }
         }
 
-        const auto& data = *it;
+        const auto& data = *found;
 
-        if (size_t id = file_handler_factory::supports(data.stream, path, _tag); id != file_handler_factory::npos) {
+        probe_identity identity { .size = data.size, .mtime = 0, .stream = data.stream };
+
+        if (size_t id = _probe(path, identity, [&data] { return std::optional { data.stream }; }, _tag); id != file_handler_factory::npos) {
             return retvalf(_tag, [&] { return file_handler_factory::create(id, data.stream, path); });
         }
     } else {
@@ -344,17 +418,31 @@ file_handler_ptr nao_model::_provider_for(std::string path, bool* result, file_h
         if (info.directory()) {
             // file_info considers "\" a directory as well, so that is included in this
 
-            if (size_t id = id = file_handler_factory::supports(nullptr, path, _tag); id != file_handler_factory::npos) {
+            probe_identity identity { .size = info.size(), .mtime = info.mtime() };
+
+            if (size_t id = _probe(path, identity, [] { return std::optional { istream_ptr { } }; }, _tag); id != file_handler_factory::npos) {
                 return retvalf(_tag, [&] { return file_handler_factory::create(id, nullptr, path); });
             }
         } else {
-            // Create file stream
-            auto stream = std::make_shared<istream_ptr::element_type>(path);
+            // Create file stream, memory-mapped so parsers can read in-place
+            istream_ptr stream;
+            auto open = [&stream, &path]() -> std::optional<istream_ptr> {
+                if (!stream) {
+                    stream = std::make_shared<istream_ptr::element_type>(std::filesystem::path(nao::to_utf16(path)), true);
+                }
 
-            if (stream->good()) {
-                if (size_t id = file_handler_factory::supports(stream, path, _tag); id != file_handler_factory::npos) {
-                    return retvalf(_tag, [&] { return file_handler_factory::create(id, stream, path); });
+                if (!stream->good()) {
+                    return std::nullopt;
                 }
+
+                return stream;
+            };
+
+            probe_identity identity { .size = info.size(), .mtime = info.mtime() };
+
+            // Unchanged files are resolved without opening them
+            if (size_t id = _probe(path, identity, open, _tag); id != file_handler_factory::npos) {
+                return retvalf(_tag, [&] { return file_handler_factory::create(id, *open(), path); });
             }
         }
     }
@@ -1,8 +1,13 @@
 #pragma once
 
 #include "file_handler.h"
+#include "metadata_prober.h"
+#include "handler_cache.h"
 
 #include <deque>
+#include <functional>
+#include <optional>
+#include <unordered_map>
 
 class nao_view;
 class nao_controller;
@@ -10,6 +15,34 @@ class nao_controller;
 class provider_for_wrapper;
 
 class nao_model {
+    // Items published per update while populating the current provider
+    static constexpr size_t populate_batch_size = 512;
+
+    // Memory budget for containers kept alive after leaving them
+    static constexpr size_t handler_cache_budget = 256 * 1024 * 1024;
+
+    // Cached probes before the cache is cleared
+    static constexpr size_t max_cached_probes = 65536;
+
+    // What a probe result depends on, other than the path
+    struct probe_identity {
+        int64_t size;
+        int64_t mtime;
+
+        // Stream of a virtual file, shared with its container
+        std::weak_ptr<binary_istream> stream;
+
+        bool operator==(const probe_identity& other) const;
+    };
+
+    struct cached_probe {
+        probe_identity identity;
+
+        // Handler id, or file_handler_factory::npos if unsupported
+        size_t id;
+        file_handler_tag tag;
+    };
+
     std::string _m_path;
     public:
     explicit nao_model(nao_view& view, nao_controller& controller);
@@ -45,8 +78,15 @@ class nao_model {
     private:
     void _create_tree(const std::string& to);
 
+    // Publish the next batch of the given provider if it is still current
+    void _populate(const item_file_handler_ptr& provider);
+
     file_handler_ptr _provider_for(std::string path, bool* result = nullptr, file_handler_tag* tag = nullptr);
 
+    // Handler id for a path, only running the factory's probe if the file changed since the last call
+    size_t _probe(const std::string& path, const probe_identity& identity,
+        const std::function<std::optional<istream_ptr>()>& open, file_handler_tag& tag);
+
     protected:
     nao_view& view;
     nao_controller& controller;
@@ -54,4 +94,10 @@ class nao_model {
     private:
     std::deque<item_file_handler_ptr> _m_tree;
     file_handler_ptr _m_preview_provider;
+
+    metadata_prober _m_prober;
+
+    // Only accessed from the worker thread
+    std::unordered_map<std::string, cached_probe> _m_probe_cache;
+    handler_cache _m_handler_cache { handler_cache_budget };
 };
@@ -17,7 +17,7 @@
 #include <nao/strings.h>
 
 const std::vector<std::string>& nao_view::list_view_header() {
-    static std::vector<std::string> vec { "Name", "Type", "Size", "Compressed" };
+    static std::vector<std::string> vec { "Name", "Type", "Size", "Compressed", "Duration", "Codec" };
 
     return vec;
 }
@@ -27,7 +27,9 @@ const std::map<data_key, sort_order>& nao_view::list_view_default_sort() {
         { KEY_NAME, ORDER_NORMAL },
         { KEY_TYPE, ORDER_NORMAL },
         { KEY_SIZE, ORDER_REVERSE },
-        { KEY_COMP, ORDER_REVERSE }
+        { KEY_COMP, ORDER_REVERSE },
+        { KEY_DURATION, ORDER_REVERSE },
+        { KEY_CODEC, ORDER_NORMAL }
     };
 
     return map;
@@ -75,6 +77,7 @@ void nao_view::set_path(const std::string& path) const {
 
 void nao_view::clear_view(const std::function<void(void*)>& deleter) const {
     _main_window->left().list().clear(deleter);
+    _rows.clear();
 }
 
 void nao_view::fill_view(std::vector<list_view_row> items) const {
@@ -99,9 +102,9 @@ void nao_view::fill_view(std::vector<list_view_row> items) const {
         }
     }
 
-    for (const auto& [name, type, size, compressed,
+    for (const auto& [name, type, size, compressed, duration, codec,
             icon ,data] : items) {
-        list.add_item({ name, type, size, compressed }, icon, data);
+        _rows[data] = list.add_item({ name, type, size, compressed, duration, codec }, icon, data);
     }
 
     // Fit columns
@@ -116,6 +119,49 @@ void nao_view::fill_view(std::vector<list_view_row> items) const {
     }
 }
 
+void nao_view::append_view(const std::vector<list_view_row>& items) const {
+    if (items.empty()) {
+        return;
+    }
+
+    list_view& list = _main_window->left().list();
+
+    for (const auto& [name, type, size, compressed, duration, codec,
+            icon, data] : items) {
+        list.add_item({ name, type, size, compressed, duration, codec }, icon, data);
+    }
+
+    _sort_list();
+}
+
+void nao_view::update_items(const std::vector<list_view_row>& items) const {
+    if (items.empty()) {
+        return;
+    }
+
+    list_view& list = _main_window->left().list();
+
+    // Repaint once for the whole batch
+    list.set_redraw(false);
+
+    for (const list_view_row& item : items) {
+        auto it = _rows.find(item.data);
+        if (it == _rows.end()) {
+            continue;
+        }
+
+        // Only the probed columns change
+        list.set_item_text(it->second, KEY_DURATION, item.duration);
+        list.set_item_text(it->second, KEY_CODEC, item.codec);
+    }
+
+    if (_selected_column == KEY_DURATION || _selected_column == KEY_CODEC) {
+        _sort_list();
+    }
+
+    list.set_redraw(true);
+}
+
 void nao_view::button_clicked(view_button_type which) const {
 
     switch (which) {
@@ -207,15 +253,7 @@ void nao_view::list_clicked(NMHDR* nm) {
                 }
             }
 
-            static auto sort_func = [](LPARAM lparam1, LPARAM lparam2, LPARAM info) {
-                nao_view const* view = reinterpret_cast<nao_view const*>(info);
-
-                return view->controller.order_items(
-                    reinterpret_cast<item_data*>(lparam1), reinterpret_cast<item_data*>(lparam2),
-                    view->selected_column(), view->selected_column_order());
-            };
-
-            list.sort(sort_func, this);
+            _sort_list();
             break;
         }
 
@@ -326,3 +364,28 @@ sort_order nao_view::selected_column_order() const {
 nao_controller& nao_view::get_controller() const {
     return controller;
 }
+
+void nao_view::_sort_list() const {
+    static auto sort_func = [](LPARAM lparam1, LPARAM lparam2, LPARAM info) {
+        nao_view const* view = reinterpret_cast<nao_view const*>(info);
+
+        return view->controller.order_items(
+            reinterpret_cast<item_data*>(lparam1), reinterpret_cast<item_data*>(lparam2),
+            view->selected_column(), view->selected_column_order());
+    };
+
+    _main_window->left().list().sort(sort_func, this);
+
+    _index_rows();
+}
+
+void nao_view::_index_rows() const {
+    list_view& list = _main_window->left().list();
+
+    _rows.clear();
+
+    int count = list.item_count();
+    for (int i = 0; i < count; ++i) {
+        _rows[list.get_item_data(i)] = i;
+    }
+}
@@ -7,6 +7,7 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <unordered_map>
 
 class nao_controller;
 class main_window;
@@ -16,6 +17,8 @@ struct list_view_row {
     std::string type;
     std::string size;
     std::string compressed;
+    std::string duration;
+    std::string codec;
 
     int icon { };
     void* data { };
@@ -38,7 +41,9 @@ enum data_key {
     KEY_NAME = 0,
     KEY_TYPE,
     KEY_SIZE,
-    KEY_COMP
+    KEY_COMP,
+    KEY_DURATION,
+    KEY_CODEC
 };
 
 struct context_menu_entry {
@@ -57,6 +62,9 @@ class nao_view {
     std::map<data_key, sort_order> _sort_order = list_view_default_sort();
     data_key _selected_column = KEY_NAME;
 
+    // Row of every item in the list, by data. Rebuilt whenever rows are added or sorted.
+    mutable std::unordered_map<void*, int> _rows;
+
     public:
     static const std::vector<std::string>& list_view_header();
     static const std::map<data_key, sort_order>& list_view_default_sort();
@@ -78,6 +86,12 @@ class nao_view {
     // Fills the view from the given elements, applying the correct sorting
     void fill_view(std::vector<list_view_row> items) const;
 
+    // Adds elements to the current view, keeping it sorted
+    void append_view(const std::vector<list_view_row>& items) const;
+
+    // Replace the probed columns of the elements with the same data, re-sorting if needed
+    void update_items(const std::vector<list_view_row>& items) const;
+
     // Signals that a button has been clicked
     void button_clicked(view_button_type which) const;
 
@@ -106,6 +120,13 @@ class nao_view {
     // Paired controller
     nao_controller& get_controller() const;
 
+    private:
+    // Sort the list by the selected column
+    void _sort_list() const;
+
+    // Rebuild the row lookup after rows have moved
+    void _index_rows() const;
+
     protected:
     nao_controller& controller;
 };
@@ -1,8 +1,33 @@
 #include "partial_file_streambuf.h"
 
-partial_file_streambuf::partial_file_streambuf(const istream_ptr& stream, std::streamoff start, std::streamsize size)
-    : _stream { stream }, _start { start }, _size { size } {
-    setg(_buf, _buf + buf_size, _buf + buf_size);
+partial_file_streambuf::partial_file_streambuf(const istream_ptr& stream, std::streamoff start, std::streamsize size,
+    std::streamsize max_buf_size)
+    : _stream { stream }, _start { start }, _size { size }
+    , _max_buf_size { std::max(max_buf_size, min_buf_size) } {
+    // Collapse nested ranges into a single range over the root
+    if (auto parent = dynamic_cast<partial_file_streambuf*>(_stream->rdbuf())) {
+        _start = parent->_start + std::clamp<std::streamoff>(_start, 0, parent->_size);
+        _size = std::clamp<std::streamsize>(_size, 0, (parent->_start + parent->_size) - _start);
+        _stream = parent->_stream;
+    }
+
+    setg(_buf.data(), _buf.data(), _buf.data());
+}
+
+const istream_ptr& partial_file_streambuf::root() const {
+    return _stream;
+}
+
+std::streamoff partial_file_streambuf::start() const {
+    return _start;
+}
+
+std::streamsize partial_file_streambuf::size() const {
+    return _size;
+}
+
+std::streamsize partial_file_streambuf::buffer_size() const {
+    return static_cast<std::streamsize>(_buf.capacity());
 }
 
 partial_file_streambuf::int_type partial_file_streambuf::underflow() {
@@ -12,25 +37,68 @@ partial_file_streambuf::int_type partial_file_streambuf::underflow() {
         return traits_type::eof();
     }
 
-    _stream->seekg(_start + cur);
-    
+    std::streamsize buf_size = _next_buf_size();
+    _buf.resize(buf_size);
+
     // How many bytes to read
     auto count = std::min<std::streamsize>(_size - cur, buf_size);
 
-    // Read into buffer
-    _stream->read(_buf, count);
+    // Positional read, the parent stream may be shared with other items
+    count = _stream->read_at(_start + cur, _buf.data(), count);
+    if (count <= 0) {
+        return traits_type::eof();
+    }
 
     // Advance position
     _buf_pos = cur;
 
     // Reset get area
-    setg(_buf, _buf, _buf + count);
+    setg(_buf.data(), _buf.data(), _buf.data() + count);
 
-    _buf_valid = true;
+    _sequential = true;
 
     return traits_type::to_int_type(*gptr());
 }
 
+std::streamsize partial_file_streambuf::xsgetn(char* s, std::streamsize count) {
+    std::streamsize total = 0;
+
+    // Use whatever is left in the buffer first
+    std::streamsize available = std::min<std::streamsize>(egptr() - gptr(), count);
+    if (available > 0) {
+        memcpy(s, gptr(), available);
+        gbump(static_cast<int>(available));
+
+        total += available;
+    }
+
+    if (total == count) {
+        return total;
+    }
+
+    // Reads that wouldn't fit in the next buffer go straight to the parent
+    if ((count - total) >= _next_buf_size()) {
+        auto cur = _cur();
+
+        std::streamsize bytes = std::min<std::streamsize>(count - total, _size - cur);
+        if (bytes > 0) {
+            bytes = std::max<std::streamsize>(_stream->read_at(_start + cur, s + total, bytes), 0);
+
+            total += bytes;
+            cur += bytes;
+        }
+
+        // Empty get area at the new position
+        _buf_pos = cur;
+        setg(_buf.data(), _buf.data(), _buf.data());
+
+        _sequential = true;
+
+        return total;
+    }
+
+    return total + std::streambuf::xsgetn(s + total, count - total);
+}
 
 std::streamsize partial_file_streambuf::showmanyc() {
     return _size - _cur();
@@ -48,28 +116,34 @@ partial_file_streambuf::pos_type partial_file_streambuf::seekoff(off_type offset
 }
 
 partial_file_streambuf::pos_type partial_file_streambuf::seekpos(pos_type pos, std::ios::openmode) {
-    if (pos >= _size) {
+    if (pos < 0 || pos > _size) {
         return -1;
     }
 
     // If the new position is inside the buffer
-    if (_buf_valid && pos >= _buf_pos && pos < (_buf_pos + std::distance(eback(), gptr()))) {
-        setg(_buf, _buf + (pos - _buf_pos), _buf + buf_size);
-        return _buf_pos + (pos - _buf_pos);
+    if (pos >= _buf_pos && pos <= (_buf_pos + std::distance(eback(), egptr()))) {
+        setg(eback(), eback() + (pos - _buf_pos), egptr());
+        return pos;
     }
 
     // Not inside buffer
-    setg(_buf, _buf + buf_size, _buf + buf_size);
-    _buf_valid = false;
     _buf_pos = pos;
+    setg(_buf.data(), _buf.data(), _buf.data());
+
+    _sequential = false;
 
     return pos;
 }
 
-std::streamoff partial_file_streambuf::_cur() const {
-    if (!_buf_valid) {
-        return _buf_pos;
+std::streamsize partial_file_streambuf::_next_buf_size() const {
+    // Grow for sequential reads, start small again after a seek
+    if (_sequential) {
+        return std::clamp<std::streamsize>(_buf.size() * 2, min_buf_size, _max_buf_size);
     }
 
+    return min_buf_size;
+}
+
+std::streamoff partial_file_streambuf::_cur() const {
     return _buf_pos + std::distance(eback(), gptr());
 }
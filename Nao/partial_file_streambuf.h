@@ -2,27 +2,51 @@
 
 #include "binary_stream.h"
 
+#include <vector>
+
 class partial_file_streambuf : public std::streambuf {
-    static constexpr size_t buf_size = 4096;
+    static constexpr std::streamsize min_buf_size = 4096;
 
     istream_ptr _stream;
 
     std::streamoff _start;
     std::streamsize _size;
-    char _buf[buf_size] { };
 
+    // Read-ahead buffer, allocated on the first read and doubling in size on every sequential
+    // refill up to _max_buf_size
+    std::vector<char> _buf;
+    std::streamsize _max_buf_size;
+
+    // Offset of the start of the get area
     std::streamoff _buf_pos = 0;
 
-    bool _buf_valid = false;
+    // Whether the next refill continues where the previous read ended
+    bool _sequential = false;
 
     public:
-    partial_file_streambuf(const istream_ptr& stream, std::streamoff start, std::streamsize size);
+    static constexpr std::streamsize default_max_buf_size = 1 << 20;
+
+    // If stream is itself a partial stream, the range is resolved against its root stream instead
+    partial_file_streambuf(const istream_ptr& stream, std::streamoff start, std::streamsize size,
+        std::streamsize max_buf_size = default_max_buf_size);
+
+    // Root stream this range refers to, never a partial stream itself
+    const istream_ptr& root() const;
+
+    // Absolute offset into the root stream
+    std::streamoff start() const;
+    std::streamsize size() const;
+
+    // Bytes allocated for the read-ahead buffer
+    std::streamsize buffer_size() const;
 
     protected:
     int_type underflow() override;
+    std::streamsize xsgetn(char* s, std::streamsize count) override;
     std::streamsize showmanyc() override;
     pos_type seekoff(off_type offset, std::ios::seekdir dir, std::ios::openmode mode) override;
     pos_type seekpos(pos_type pos, std::ios::openmode mode) override;
 
     std::streamoff _cur() const;
+    std::streamsize _next_buf_size() const;
 };
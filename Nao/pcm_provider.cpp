@@ -82,6 +82,10 @@ pcm_samples::pcm_samples(sample_format type, uint64_t frames, uint8_t channels,
     
 }
 
+sample_format pcm_samples::format() const {
+    return _type;
+}
+
 int64_t pcm_samples::frames() const {
     return _frames;
 }
@@ -100,7 +100,7 @@ enum pcm_state : int64_t {
     PCM_ERR = -1
 };
 
-// Encapsulates audio samples
+// Encapsulates audio samples, planar formats store each channel's frames contiguously
 class pcm_samples final {
     sample_format _type = sample_format::none;
     uint64_t _frames = 0;
@@ -114,6 +114,7 @@ class pcm_samples final {
     pcm_samples() = default;
     pcm_samples(sample_format type, uint64_t frames, uint8_t channels, uint64_t channel_layout);
 
+    sample_format format() const;
     int64_t frames() const;
     uint8_t channels() const;
     int64_t samples() const;
@@ -58,10 +58,10 @@ list_view_preview::list_view_preview(nao_view& view, item_file_handler* handler)
         }
     }
 
-    for (const auto& [name, type, size, compressed,
+    for (const auto& [name, type, size, compressed, duration, codec,
         icon, data] : items) {
 
-        _list.add_item({ name, type, size, compressed }, icon, data);
+        _list.add_item({ name, type, size, compressed, duration, codec }, icon, data);
     }
 
     // Fit columns
@@ -23,7 +23,7 @@
 #define IDS_VIDEO_PLAYER_PREVIEW_CANVAS 114
 #define IDS_SDL_WINDOW                  115
 #define IDR_MAINFRAME                   128
-#define IDR_PACKED_CODEBOOKS_AOTUV_603  134
+#define IDR_REBUILT_CODEBOOKS_AOTUV_603 135
 #define IDC_TPL_LINK                    1010
 #define ID_FILE_OPEN                    32772
 #define IDC_STATIC                      -1
@@ -33,7 +33,7 @@
 #ifdef APSTUDIO_INVOKED
 #ifndef APSTUDIO_READONLY_SYMBOLS
 #define _APS_NO_MFC                     1
-#define _APS_NEXT_RESOURCE_VALUE        135
+#define _APS_NEXT_RESOURCE_VALUE        136
 #define _APS_NEXT_COMMAND_VALUE         32773
 #define _APS_NEXT_CONTROL_VALUE         1011
 #define _APS_NEXT_SYMED_VALUE           110
@@ -0,0 +1,138 @@
+#include "riff_scanner.h"
+
+#include "riff.h"
+#include "stream_cursor.h"
+#include "thread_pool.h"
+
+#include <emmintrin.h>
+
+#include <bit>
+#include <latch>
+
+namespace detail {
+    // Bitmask of positions in [data, data + 16) where "RIFF" is followed by "WAVE" 8 bytes later,
+    // reads up to data + 28
+    static uint32_t signature_mask(const char* data) {
+        auto match = [data](size_t offset, char c) {
+            return _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset)), _mm_set1_epi8(c));
+        };
+
+        __m128i riff = _mm_and_si128(_mm_and_si128(match(0, 'R'), match(1, 'I')), _mm_and_si128(match(2, 'F'), match(3, 'F')));
+        __m128i wave = _mm_and_si128(_mm_and_si128(match(8, 'W'), match(9, 'A')), _mm_and_si128(match(10, 'V'), match(11, 'E')));
+
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(riff, wave)));
+    }
+
+    static bool is_signature(const char* data) {
+        return memcmp(data, "RIFF", 4) == 0 && memcmp(data + 8, "WAVE", 4) == 0;
+    }
+}
+
+riff_scanner::riff_scanner(const istream_ptr& stream) : _stream { stream } {
+    _size = with_cursor(*stream, [](auto& cursor) {
+        auto pos = cursor.tellg();
+        cursor.seekg(0, std::ios::end);
+
+        std::streamsize size = cursor.tellg();
+        cursor.seekg(pos);
+
+        return size;
+    });
+}
+
+std::vector<riff_scanner::match> riff_scanner::scan() const {
+    size_t chunk_count = std::clamp<size_t>(
+        static_cast<size_t>(_size / min_chunk_size), 1, std::max<size_t>(thread_pool::pool_size(), 1));
+
+    std::vector<std::vector<match>> chunks(chunk_count);
+
+    if (chunk_count == 1) {
+        chunks.front() = _scan_range(0, _size);
+    } else {
+        std::latch done { static_cast<ptrdiff_t>(chunk_count) };
+
+        for (size_t i = 0; i < chunk_count; ++i) {
+            thread_pool::shared().push([this, i, chunk_count, &chunks, &done] {
+                try {
+                    chunks[i] = _scan_range((_size * i) / chunk_count, (_size * (i + 1)) / chunk_count);
+                } catch (const std::exception& e) {
+                    nao::coutln("failed to scan range:", e.what());
+                }
+
+                done.count_down();
+            });
+        }
+
+        done.wait();
+    }
+
+    // Skip signatures inside a previous file, like a sequential scan would
+    std::vector<match> result;
+    std::streamoff next = 0;
+
+    for (const auto& chunk : chunks) {
+        for (const match& m : chunk) {
+            if (m.offset >= next) {
+                result.push_back(m);
+                next = m.offset + m.size;
+            }
+        }
+    }
+
+    return result;
+}
+
+std::vector<riff_scanner::match> riff_scanner::_scan_range(std::streamoff start, std::streamoff end) const {
+    std::vector<match> result;
+    std::vector<char> buf;
+
+    for (std::streamoff pos = start; pos < end; pos += block_size) {
+        // Overlap into the next block so signatures crossing the boundary are found
+        std::streamsize count = std::min<std::streamsize>(block_size, end - pos);
+        std::streamsize bytes = std::min<std::streamsize>(count + signature_size - 1, _size - pos);
+
+        // Memory-backed streams are searched in-place
+        const char* data = reinterpret_cast<const char*>(_stream->view(pos, bytes).data());
+        if (!data) {
+            buf.resize(bytes);
+            bytes = _stream->read_at(pos, buf.data(), bytes);
+            data = buf.data();
+        }
+
+        auto add = [&](std::streamsize i) {
+            riff_header hdr;
+            memcpy(&hdr, data + i, sizeof(hdr));
+
+            // Reject candidates whose size points past the end of the stream
+            std::streamsize size = hdr.size + 8i64;
+            if (size >= signature_size && (pos + i + size) <= _size) {
+                result.push_back({ .offset = pos + i, .size = size });
+            }
+        };
+
+        std::streamsize last = std::min(count, bytes - signature_size + 1);
+        std::streamsize i = 0;
+
+        // 16 positions at a time while the loads stay inside the buffer
+        for (; (i + 16 + signature_size) <= bytes && i < last; i += 16) {
+            uint32_t mask = detail::signature_mask(data + i);
+
+            while (mask != 0) {
+                std::streamsize bit = std::countr_zero(mask);
+                mask &= mask - 1;
+
+                if ((i + bit) < last) {
+                    add(i + bit);
+                }
+            }
+        }
+
+        for (; i < last; ++i) {
+            if (detail::is_signature(data + i)) {
+                add(i);
+            }
+        }
+    }
+
+    return result;
+}
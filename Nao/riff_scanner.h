@@ -0,0 +1,38 @@
+#pragma once
+
+#include "binary_stream.h"
+
+#include <vector>
+
+// Locates RIFF WAVE files embedded in a container without going through the stream byte by byte.
+// Large streams are split into chunks that are scanned in parallel.
+class riff_scanner {
+    // Bytes searched per read
+    static constexpr std::streamsize block_size = 1 << 20;
+
+    // Streams smaller than this per thread are scanned by a single thread
+    static constexpr std::streamsize min_chunk_size = 64 << 20;
+
+    // "RIFF", size, "WAVE"
+    static constexpr std::streamsize signature_size = 12;
+
+    istream_ptr _stream;
+    std::streamsize _size;
+
+    public:
+    struct match {
+        std::streamoff offset;
+
+        // Including the RIFF header
+        std::streamsize size;
+    };
+
+    explicit riff_scanner(const istream_ptr& stream);
+
+    // Non-overlapping RIFF WAVE files in order, a file's contents are never searched
+    std::vector<match> scan() const;
+
+    private:
+    // Every valid signature starting in [start, end)
+    std::vector<match> _scan_range(std::streamoff start, std::streamoff end) const;
+};
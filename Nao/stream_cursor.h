@@ -0,0 +1,241 @@
+#pragma once
+
+#include "binary_stream.h"
+#include "byte_array_streambuf.h"
+
+namespace detail {
+    // Typed reads shared by all cursor specializations
+    template <typename Derived>
+    class cursor_base {
+        public:
+        // Read a POD value array
+        template <concepts::pod T>
+        Derived& read(T* buf, std::streamsize bytes) {
+            return _derived().read(reinterpret_cast<char*>(buf), bytes);
+        }
+
+        // Read any container which exposes ::data(), ::size() and ::value_type
+        template <concepts::readable_container Container>
+        Derived& read(Container& buf) {
+            return _derived().read(reinterpret_cast<char*>(buf.data()), buf.size() * sizeof(Container::value_type));
+        }
+
+        // Read an arithmetic value in native endianness
+        template <concepts::arithmetic T>
+        T read() {
+            T val { };
+            _derived().read(reinterpret_cast<char*>(&val), sizeof(T));
+
+            return val;
+        }
+
+        // Read an arithmetic value into the argument
+        template <concepts::arithmetic T>
+        Derived& read(T& val) {
+            val = read<T>();
+
+            return _derived();
+        }
+
+        private:
+        Derived& _derived() {
+            return static_cast<Derived&>(*this);
+        }
+    };
+}
+
+// Exclusive reader over a binary_istream. The stream is locked for the cursor's entire
+// lifetime and must not be used directly until the cursor is destroyed.
+// Reads go straight to the streambuf, without locking or virtual calls per field.
+template <typename Buf = std::streambuf>
+class stream_cursor : public detail::cursor_base<stream_cursor<Buf>> {
+    std::unique_lock<std::mutex> _m_lock;
+    std::istream& _m_file;
+    Buf* _m_buf;
+
+    std::streamsize _m_gcount { };
+    bool _m_eof { };
+
+    public:
+    using pos_type = std::streambuf::pos_type;
+    using off_type = std::streambuf::off_type;
+    using seekdir = std::ios::seekdir;
+
+    using detail::cursor_base<stream_cursor>::read;
+
+    explicit stream_cursor(binary_istream& stream)
+        : _m_lock { stream.mutex }, _m_file { *stream.file }
+        , _m_buf { static_cast<Buf*>(stream.file->rdbuf()) } {
+        ASSERT(!stream._m_bitwise);
+    }
+
+    stream_cursor(const stream_cursor&) = delete;
+    stream_cursor& operator=(const stream_cursor&) = delete;
+
+    ~stream_cursor() {
+        _m_file.clear(_m_eof ? (std::ios::eofbit | std::ios::failbit) : std::ios::goodbit);
+    }
+
+    stream_cursor& read(char* buf, std::streamsize count) {
+        _m_gcount = _m_buf->sgetn(buf, count);
+
+        if (_m_gcount < count) {
+            _m_eof = true;
+        }
+
+        return *this;
+    }
+
+    pos_type tellg() const {
+        return _m_buf->pubseekoff(0, std::ios::cur, std::ios::in);
+    }
+
+    stream_cursor& seekg(pos_type pos) {
+        _m_buf->pubseekpos(pos, std::ios::in);
+        _m_eof = false;
+
+        return *this;
+    }
+
+    stream_cursor& seekg(off_type offset, seekdir dir) {
+        _m_buf->pubseekoff(offset, dir, std::ios::in);
+        _m_eof = false;
+
+        return *this;
+    }
+
+    // Skip until after delim, or until max characters were skipped
+    stream_cursor& ignore(std::streamsize max, std::streambuf::int_type delim) {
+        for (std::streamsize i = 0; i < max; ++i) {
+            auto c = _m_buf->sbumpc();
+            if (std::streambuf::traits_type::eq_int_type(c, std::streambuf::traits_type::eof())) {
+                _m_eof = true;
+                break;
+            }
+
+            if (c == delim) {
+                break;
+            }
+        }
+
+        return *this;
+    }
+
+    std::streamsize gcount() const {
+        return _m_gcount;
+    }
+
+    bool eof() const {
+        return _m_eof;
+    }
+};
+
+// Contiguous buffers are read in-place, the streambuf position is synchronized on destruction
+template <>
+class stream_cursor<byte_array_streambuf> : public detail::cursor_base<stream_cursor<byte_array_streambuf>> {
+    std::unique_lock<std::mutex> _m_lock;
+    std::istream& _m_file;
+    byte_array_streambuf* _m_buf;
+
+    const char* _m_begin;
+    const char* _m_pos;
+    const char* _m_end;
+
+    std::streamsize _m_gcount { };
+    bool _m_eof { };
+
+    public:
+    using pos_type = std::streambuf::pos_type;
+    using off_type = std::streambuf::off_type;
+    using seekdir = std::ios::seekdir;
+
+    using detail::cursor_base<stream_cursor>::read;
+
+    explicit stream_cursor(binary_istream& stream)
+        : _m_lock { stream.mutex }, _m_file { *stream.file }
+        , _m_buf { static_cast<byte_array_streambuf*>(stream.file->rdbuf()) }
+        , _m_begin { _m_buf->data() }, _m_pos { _m_begin + _m_buf->tell() }
+        , _m_end { _m_begin + _m_buf->size() } {
+        ASSERT(!stream._m_bitwise);
+    }
+
+    stream_cursor(const stream_cursor&) = delete;
+    stream_cursor& operator=(const stream_cursor&) = delete;
+
+    ~stream_cursor() {
+        _m_buf->pubseekpos(_m_pos - _m_begin, std::ios::in);
+        _m_file.clear(_m_eof ? (std::ios::eofbit | std::ios::failbit) : std::ios::goodbit);
+    }
+
+    stream_cursor& read(char* buf, std::streamsize count) {
+        _m_gcount = std::min<std::streamsize>(count, _m_end - _m_pos);
+        memcpy(buf, _m_pos, _m_gcount);
+        _m_pos += _m_gcount;
+
+        if (_m_gcount < count) {
+            _m_eof = true;
+        }
+
+        return *this;
+    }
+
+    pos_type tellg() const {
+        return _m_pos - _m_begin;
+    }
+
+    stream_cursor& seekg(pos_type pos) {
+        _m_pos = _m_begin + std::clamp<std::streamoff>(pos, 0, _m_end - _m_begin);
+        _m_eof = false;
+
+        return *this;
+    }
+
+    stream_cursor& seekg(off_type offset, seekdir dir) {
+        switch (dir) {
+            case std::ios::beg: return seekg(offset);
+            case std::ios::cur: return seekg((_m_pos - _m_begin) + offset);
+            case std::ios::end: return seekg((_m_end - _m_begin) + offset);
+            default: break;
+        }
+
+        return *this;
+    }
+
+    // Skip until after delim, or until max characters were skipped
+    stream_cursor& ignore(std::streamsize max, std::streambuf::int_type delim) {
+        std::streamsize count = std::min<std::streamsize>(max, _m_end - _m_pos);
+
+        auto found = static_cast<const char*>(memchr(_m_pos, delim, count));
+        if (found) {
+            _m_pos = found + 1;
+        } else {
+            _m_pos += count;
+
+            if (_m_pos == _m_end && count < max) {
+                _m_eof = true;
+            }
+        }
+
+        return *this;
+    }
+
+    std::streamsize gcount() const {
+        return _m_gcount;
+    }
+
+    bool eof() const {
+        return _m_eof;
+    }
+};
+
+// Invoke func with the most specialized cursor available for the stream
+template <typename Func>
+decltype(auto) with_cursor(binary_istream& stream, Func&& func) {
+    if (dynamic_cast<byte_array_streambuf*>(stream.rdbuf())) {
+        stream_cursor<byte_array_streambuf> cursor { stream };
+        return func(cursor);
+    }
+
+    stream_cursor<> cursor { stream };
+    return func(cursor);
+}
@@ -4,6 +4,11 @@ size_t thread_pool::pool_size() {
     return std::thread::hardware_concurrency();
 }
 
+thread_pool& thread_pool::shared() {
+    static thread_pool pool;
+    return pool;
+}
+
 thread_pool::thread_pool() : thread_pool(pool_size()) {
 
 }
@@ -44,50 +49,30 @@ thread_pool::thread_pool(size_t n_threads, const std::function<void()>& before,
             _m_before();
         }
 
-        bool is_empty;
-
-        {
-            std::unique_lock lock(_m_queue_mutex);
-            is_empty = _m_queue.empty();
-        }
-
         while (true) {
-            while (!is_empty) {
-                std::unique_ptr<std::function<void()>> func;
+            std::unique_ptr<std::function<void()>> func;
 
-                {
-                    std::unique_lock lock(_m_queue_mutex);
-                    func.reset(_m_queue.front());
-                    _m_queue.pop();
-                }
-
-                (*func)();
+            {
+                // Wait for work, the queue is only accessed with the mutex held
+                std::unique_lock lock(_m_mutex);
+                _m_condition.wait(lock, [this]() -> bool {
+                    return !_m_queue.empty() || _m_stop;
+                });
 
                 // Stop if a kill is requested
                 if (_m_stop) {
-                    if (_m_after) {
-                        _m_after();
-                    }
-                    return;
+                    break;
                 }
 
-                std::unique_lock lock(_m_queue_mutex);
-                is_empty = _m_queue.empty();
+                func.reset(_m_queue.front());
+                _m_queue.pop();
             }
 
-            // Queue is empty, wait using condition_variable
-            std::unique_lock lock(_m_mutex);
-            _m_condition.wait(lock, [this, &is_empty]() -> bool {
-                is_empty = _m_queue.empty();
-                return !is_empty || _m_stop;
-            });
+            (*func)();
+        }
 
-            if (_m_stop) {
-                if (_m_after) {
-                    _m_after();
-                }
-                return;
-            }
+        if (_m_after) {
+            _m_after();
         }
     };
 
@@ -97,7 +82,7 @@ thread_pool::thread_pool(size_t n_threads, const std::function<void()>& before,
 }
 
 size_t thread_pool::queue_size() const {
-    std::unique_lock lock(_m_queue_mutex);
+    std::unique_lock lock(_m_mutex);
 
     return _m_queue.size();
 }
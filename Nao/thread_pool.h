@@ -14,6 +14,10 @@ class thread_pool {
     public:
     static size_t pool_size();
 
+    // Process-wide pool for background work, so modules don't each keep their own idle threads.
+    // Tasks must not block on other tasks in this pool.
+    static thread_pool& shared();
+
     explicit thread_pool();
     explicit thread_pool(size_t n_threads);
     explicit thread_pool(size_t n_threads, const std::function<void()>& before, const std::function<void()>& after = {});
@@ -45,10 +49,9 @@ class thread_pool {
                     throw;
                 }
             }));
-        }
 
-        std::unique_lock lock(_m_mutex);
-        _m_condition.notify_one();
+            _m_condition.notify_one();
+        }
 
         return packed;
     }
@@ -57,8 +60,7 @@ class thread_pool {
     std::vector<std::unique_ptr<std::thread>> _m_threads;
 
     std::queue<std::function<void()>*> _m_queue;
-    mutable std::mutex _m_queue_mutex;
-    std::mutex _m_mutex;
+    mutable std::mutex _m_mutex;
     std::condition_variable _m_condition;
     std::atomic<bool> _m_stop;
 
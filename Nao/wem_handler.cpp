@@ -3,14 +3,29 @@
 #include "file_handler_factory.h"
 
 #include "wem_pcm_provider.h"
+#include "wwriff_pcm_provider.h"
 
 #include "riff.h"
+#include "stream_cursor.h"
 
 file_handler_tag wem_handler::tag() const {
     return TAG_PCM;
 }
 
 pcm_provider_ptr wem_handler::make_provider() {
+    uint16_t format = with_cursor(*stream, [](auto& cursor) {
+        cursor.seekg(sizeof(riff_header) + sizeof(wave_chunk) + sizeof(riff_header));
+
+        fmt_chunk fmt;
+        cursor.read(&fmt, sizeof(fmt));
+        return fmt.format;
+    });
+
+    // Wwise Vorbis is decoded directly, without going through an Ogg stream
+    if (format == 0xFFFF) {
+        return std::make_shared<wwriff_pcm_provider>(stream);
+    }
+
     return std::make_shared<wem_pcm_provider>(stream);
 }
 
@@ -20,29 +35,29 @@ static file_handler_ptr create(const istream_ptr& stream, const std::string& pat
 
 static bool supports(const istream_ptr& stream, const std::string& path) {
     if (path.substr(path.size() - 4) == ".wem") {
-        riff_header hdr;
-        stream->read(&hdr, sizeof(hdr));
-        if (std::string(hdr.header, 4) != "RIFF") {
-            return false;
-        }
-
-        wave_chunk wave;
-        stream->read(&wave, sizeof(wave));
-        if (std::string(wave.wave, 4) != "WAVE") {
-            return false;
-        }
-
-        stream->read(&hdr, sizeof(hdr));
-        if (std::string(hdr.header, 4) != "fmt ") {
-            return false;
-        }
+        return with_cursor(*stream, [](auto& cursor) {
+            riff_header hdr;
+            cursor.read(&hdr, sizeof(hdr));
+            if (std::string(hdr.header, 4) != "RIFF") {
+                return false;
+            }
 
-        fmt_chunk fmt;
-        stream->read(&fmt, sizeof(fmt));
+            wave_chunk wave;
+            cursor.read(&wave, sizeof(wave));
+            if (std::string(wave.wave, 4) != "WAVE") {
+                return false;
+            }
+
+            cursor.read(&hdr, sizeof(hdr));
+            if (std::string(hdr.header, 4) != "fmt ") {
+                return false;
+            }
+
+            fmt_chunk fmt;
+            cursor.read(&fmt, sizeof(fmt));
 
-        if ((hdr.size == 66 && fmt.format == 0xFFFF) || (hdr.size == 24 && fmt.format == 0xFFFE)) {
-            return true;
-        }
+            return (hdr.size == 66 && fmt.format == 0xFFFF) || (hdr.size == 24 && fmt.format == 0xFFFE);
+        });
     }
 
     return false;
@@ -52,5 +67,7 @@ static bool supports(const istream_ptr& stream, const std::string& path) {
     .tag = TAG_PCM,
     .creator = create,
     .supports = supports,
-    .name = "wem"
+    .name = "wem",
+    .extensions = { ".wem" },
+    .signatures = { { 0, "RIFF" } }
     });
@@ -1,17 +1,12 @@
 #include "wem_pcm_provider.h"
 
+#include "composite_streambuf.h"
 #include "riff.h"
-#include "wwriff.h"
 
 #include "utils.h"
 
-#include <fstream>
-
 namespace detail {
     static istream_ptr decode(const istream_ptr& stream) {
-        auto buf = std::make_shared<binary_iostream>(
-            std::make_unique<std::stringstream>(std::ios::in | std::ios::out | std::ios::binary));
-
         stream->seekg(0);
 
         riff_header riff;
@@ -33,50 +28,47 @@ namespace detail {
         stream->read(&fmt, sizeof(fmt));
         ASSERT(stream->gcount() == sizeof(fmt));
 
-        
-
         switch (fmt.format) {
-            case 0xFFFF:
-                stream->seekg(0);
-                ASSERT(wwriff::wwriff_to_ogg(stream, buf));
-                break;
             case 0xFFFE: {
+                // Rewrite only the header, the sample data is read from the original stream
+                std::vector<char> header;
+                auto append = [&header](const auto& val) {
+                    const char* bytes = reinterpret_cast<const char*>(&val);
+                    header.insert(header.end(), bytes, bytes + sizeof(val));
+                };
+
                 riff.size += 16;
                 fmt_riff.size += 16;
 
-                buf->write(&riff, sizeof(riff));
-                buf->write(&wave, sizeof(wave));
-                buf->write(&fmt_riff, sizeof(fmt_riff));
-                buf->write(&fmt, sizeof(fmt));
+                append(riff);
+                append(wave);
+                append(fmt_riff);
+                append(fmt);
 
                 uint16_t extra_size = stream->read<uint16_t>();
                 extra_size += 16;
-                buf->write(extra_size);
+                append(extra_size);
 
                 uint16_t valid_bits = stream->read<uint16_t>();
-                buf->write(valid_bits);
+                append(valid_bits);
                 [[maybe_unused]] uint32_t channel_mask = stream->read<uint32_t>();
-                buf->write((1ui32 << fmt.channels) - 1);
+                append((1ui32 << fmt.channels) - 1);
 
                 uint8_t guid[16] = { 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71 };
-                buf->write(&guid, sizeof(guid));
+                append(guid);
 
-                char block[4096];
-                while (!stream->eof()) {
-                    stream->read(block);
+                std::streamoff data_start = stream->tellg();
+                stream->seekg(0, std::ios::end);
+                std::streamoff data_end = stream->tellg();
 
-                    size_t bytes = std::min<size_t>(4096, stream->gcount());
-                    buf->write(block, bytes);
-                }
-                break;
+                return std::make_shared<binary_istream>(
+                    std::make_unique<composite_streambuf>(std::move(header), stream, data_start, data_end - data_start));
             }
 
             default: break;
         }
 
-        buf->seekg(0);
-
-        return buf;
+        return std::make_shared<memory_iostream>();
     }
 }
 
@@ -28,5 +28,6 @@ static bool supports(const istream_ptr& stream, const std::string& path) {
     .tag = TAG_IMAGE,
     .creator = create,
     .supports = supports,
-    .name = "Windows Imaging Component"
+    .name = "Windows Imaging Component",
+    .fallback = true
     });
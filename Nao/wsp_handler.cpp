@@ -9,73 +9,67 @@
 #include "frameworks.h"
 #include "partial_file_streambuf.h"
 #include "riff.h"
+#include "riff_scanner.h"
 
 wsp_handler::wsp_handler(const istream_ptr& stream, const std::string& path)
     : file_handler(stream, path), item_file_handler(stream, path) {
-    while (!stream->eof()) {
-        wwriff_file f;
-        f.offset = stream->tellg();
-
-        std::string fcc(4, '\0');
-        stream->read(fcc);
-
-        if (fcc == "RIFF") {
-            f.size = stream->read<uint32_t>() + 8i64;
-
-            stream->read(fcc);
-            ASSERT(fcc == "WAVE");
-            _m_riff.push_back(f);
-
-            stream->seekg(f.size, std::ios::cur);
+    // Only the entry table is cached, the container body is not touched on a hit
+    if (auto cached = index_cache::load(path)) {
+        _m_riff = std::move(*cached);
+    } else {
+        for (const riff_scanner::match& match : riff_scanner(stream).scan()) {
+            _m_riff.push_back({ .offset = match.offset, .size = match.size });
         }
 
-        stream->ignore(std::numeric_limits<std::streamsize>::max(), 'R');
-
-        if (!stream->eof()) {
-            stream->rseek(-1);
-        }
+        index_cache::store(path, _m_riff);
     }
 
+    // Items are created in batches by populate_items
     items.reserve(_m_riff.size());
 
-    std::streamsize name_width = std::streamsize(log10(_m_riff.size()) + 1);
-
-    size_t i = 0;
+    _m_name_width = std::streamsize(log10(_m_riff.size()) + 1);
 
     SHFILEINFOW finfo_wem {};
     DWORD_PTR hr = SHGetFileInfoW(L".wem", FILE_ATTRIBUTE_NORMAL, &finfo_wem, sizeof(finfo_wem),
         SHGFI_TYPENAME | SHGFI_ICON | SHGFI_ICONLOCATION | SHGFI_ADDOVERLAYS | SHGFI_USEFILEATTRIBUTES);
     ASSERT(hr != 0);
 
-    std::string filename = std::filesystem::path(path).stem().string();
+    _m_type = nao::to_utf8(finfo_wem.szTypeName);
+    _m_icon = finfo_wem.iIcon;
+    _m_filename = std::filesystem::path(path).stem().string();
+}
+
+file_handler_tag wsp_handler::tag() const {
+    return TAG_ITEMS;
+}
 
-    for (const wwriff_file& wwriff : _m_riff) {
-        std::stringstream ss;
-        ss << filename << "_" << std::setfill('0') << std::setw(name_width) << i++ << ".wem";
+size_t wsp_handler::memory_usage() const {
+    return item_file_handler::memory_usage() + (_m_riff.capacity() * sizeof(wwriff_file))
+        + _m_type.capacity() + _m_filename.capacity();
+}
 
-        stream->seekg(wwriff.offset + 12);
-        riff_header hdr;
-        stream->read(&hdr, sizeof(hdr));
-        ASSERT(std::string(hdr.header, 4) == "fmt ");
+size_t wsp_handler::populate_items(size_t max) {
+    size_t first = items.size();
+    size_t last = first + std::min(max, _m_riff.size() - first);
 
-        fmt_chunk fmt;
-        stream->read(&fmt, sizeof(fmt));
-        ASSERT(stream->gcount() == sizeof(fmt));
+    for (size_t i = first; i < last; ++i) {
+        const wwriff_file& wwriff = _m_riff[i];
+
+        std::stringstream ss;
+        ss << _m_filename << "_" << std::setfill('0') << std::setw(_m_name_width) << i << ".wem";
 
         items.push_back(item_data {
             .handler = this,
             .name    = ss.str(),
-            .type    = nao::to_utf8(finfo_wem.szTypeName),
+            .type    = _m_type,
             .size    = wwriff.size,
-            .icon    = finfo_wem.iIcon,
+            .icon    = _m_icon,
             .stream  = std::make_shared<binary_istream>(std::make_unique<partial_file_streambuf>(stream, wwriff.offset, wwriff.size)),
             .data    = std::make_shared<wwriff_file>(wwriff)
             });
     }
-}
 
-file_handler_tag wsp_handler::tag() const {
-    return TAG_ITEMS;
+    return last - first;
 }
 
 static file_handler_ptr create(const istream_ptr& stream, const std::string& path) {
@@ -101,5 +95,7 @@ static bool supports(const istream_ptr& stream, const std::string& path) {
     .tag = TAG_ITEMS,
     .creator = create,
     .supports = supports,
-    .name = "wsp"
+    .name = "wsp",
+    .extensions = { ".wsp" },
+    .signatures = { { 0, "RIFF" } }
 });
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "file_handler.h"
+#include "index_cache.h"
 
 class wsp_handler : public item_file_handler {
     public:
@@ -8,11 +9,19 @@ class wsp_handler : public item_file_handler {
 
     file_handler_tag tag() const override;
 
+    size_t memory_usage() const override;
+
+    protected:
+    size_t populate_items(size_t max) override;
+
     private:
-    struct wwriff_file {
-        std::streamsize size;
-        std::streamoff offset;
-    };
+    using wwriff_file = index_cache::entry;
 
     std::vector<wwriff_file> _m_riff;
+
+    // Shared by all items
+    std::string _m_type;
+    int _m_icon { };
+    std::string _m_filename;
+    std::streamsize _m_name_width { };
 };
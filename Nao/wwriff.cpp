@@ -1,72 +1,79 @@
 #include "wwriff.h"
-#include "byte_array_streambuf.h"
 
 #include "riff.h"
+#include "stream_cursor.h"
 #include "resource.h"
 
 #include "ogg_stream.h"
 #include "vorbis_encoder.h"
+#include "thread_pool.h"
 
 #include <nao/logging.h>
 
-namespace wwriff {
-    // libvorbis
-    int ilog(unsigned int v) {
-        int ret = 0;
-        while (v) {
-            ++ret;
-            v >>= 1;
-        }
-        return ret;
-    }
+#include <latch>
+#include <unordered_map>
 
-    long book_maptype1_quantvals(long entries, long dim) {
-        if (entries < 1) {
-            return(0);
-        }
-        long vals = static_cast<long>(floor(pow(entries, 1.f / static_cast<float>(dim))));
-
-        /* the above *should* be reliable, but we'll not assume that FP is
-           ever reliable when bitstream sync is at stake; verify via integer
-           means that vals really is the greatest value of dim for which
-           vals^b->bim <= b->entries */
-           /* treat the above as an initial guess */
-        if (vals < 1) {
-            vals = 1;
-        }
-
-        while (true) {
-            long acc = 1;
-            long acc1 = 1;
-            int i;
-            for (i = 0; i < dim; ++i) {
-                if (entries / vals < acc) {
-                    break;
-                }
+namespace detail {
+    // Files with fewer packets than this per thread are converted serially
+    static constexpr size_t min_packets_per_range = 2048;
 
-                acc *= vals;
+    // Fixed codebook set, expanded at build time and shared by all conversions
+    static const rebuilt_codebook_library& aotuv_603_codebooks() {
+        static rebuilt_codebook_library codebooks(std::make_shared<binary_istream>(IDR_REBUILT_CODEBOOKS_AOTUV_603));
+        return codebooks;
+    }
 
-                if (std::numeric_limits<long>::max() / (vals + 1) < acc1) {
-                    acc1 = std::numeric_limits<long>::max();
-                } else {
-                    acc1 *= vals + 1;
-                }
-            }
+    // Rebuilt setup header and everything derived from it
+    struct setup_header {
+        // Key
+        std::vector<char> raw;
+        uint32_t channels;
+
+        std::vector<char> packet;
+        std::vector<bool> mode_flag;
+        size_t mode_bits;
+
+        uint32_t codebook_count;
+        uint32_t floor_count;
+        uint32_t residue_count;
+        uint32_t mapping_count;
+    };
+
+    // Files from the same encoder usually share their setup packet, so rebuilt headers are kept process-wide
+    static constexpr size_t max_setup_headers = 256;
+    static std::mutex setup_headers_mutex;
+    static std::unordered_multimap<size_t, std::shared_ptr<const setup_header>> setup_headers;
+
+    static size_t setup_key(const std::vector<char>& raw, uint32_t channels) {
+        return (std::hash<std::string_view>()(std::string_view(raw.data(), raw.size())) * 31) + channels;
+    }
 
-            if (i >= dim && acc <= entries && acc1 > entries) {
-                return vals;
-            }
+    static std::shared_ptr<const setup_header> find_setup(size_t key, const std::vector<char>& raw, uint32_t channels) {
+        std::unique_lock lock(setup_headers_mutex);
 
-            if (i < dim || acc > entries) {
-                --vals;
-            } else {
-                ++vals;
+        auto [begin, end] = setup_headers.equal_range(key);
+        for (auto it = begin; it != end; ++it) {
+            if (it->second->channels == channels && it->second->raw == raw) {
+                return it->second;
             }
         }
+
+        return nullptr;
     }
 
+    static void insert_setup(size_t key, std::shared_ptr<const setup_header> header) {
+        std::unique_lock lock(setup_headers_mutex);
 
+        // Start over instead of tracking usage, a batch rarely has more than a few distinct setups
+        if (setup_headers.size() >= max_setup_headers) {
+            setup_headers.clear();
+        }
 
+        setup_headers.emplace(key, std::move(header));
+    }
+}
+
+namespace wwriff {
     bool wwriff_to_ogg(const istream_ptr& in, const ostream_ptr& out) {
         auto start = std::chrono::steady_clock::now();
 
@@ -116,165 +123,83 @@ uint32_t vorbis_packet::granule() const {
     return _m_granule;
 }
 
-codebook_library::codebook_library(const istream_ptr& codebook) : stream { codebook } {
-    stream->seekg(0, std::ios::end);
-    std::streamoff filesize = stream->tellg();
-    stream->seekg(-4, std::ios::end);
-
-    uint32_t offset = stream->read<uint32_t>();
-    _m_codebook_count = static_cast<uint32_t>(filesize - offset) / 4;
-
-    stream->seekg(0);
-
-    _m_data.resize(offset);
-    stream->read(_m_data.data(), offset);
-
-    _m_offsets.resize(_m_codebook_count);
-
-    for (uint32_t i = 0; i < _m_codebook_count; ++i) {
-        auto _offset = stream->read<uint32_t>();
-        _m_offsets[i] = _offset;
-    }
-
+wwriff_converter::wwriff_converter(const istream_ptr& in) : in { in } {
+    
 }
 
-const char* codebook_library::get_codebook(uint32_t id) const {
-    if (id >= (_m_codebook_count - 1)) {
-        return nullptr;
-    }
+bool wwriff_converter::parse_info() {
+    in->seekg(0);
 
-    return _m_data.data() + _m_offsets[id];
-}
-
-std::streamsize codebook_library::get_size(uint32_t id) const {
-    if (id >= (_m_codebook_count - 1)) {
-        return -1;
-    }
+    CHECK(_validate_header());
+    CHECK(_gather_chunks());
+    CHECK(_validate_chunks());
+    CHECK(_parse_chunks());
 
-    return _m_offsets[id + 1ui64] - _m_offsets[id];
+    return true;
 }
 
-bool codebook_library::rebuild(uint32_t id, binary_ostream& os) const {
-    auto cb = get_codebook(id);
-    std::streamoff size = get_size(id);
-
-    if (size == 0 || size == -1) {
-        return false;
-    }
-
-    binary_istream in(std::make_unique<byte_array_streambuf>(cb, size));
+bool wwriff_converter::parse() {
+    CHECK(parse_info());
+    CHECK(_rebuild_setup());
+    CHECK(_index_packets());
 
-    bitwise_lock lock { in };
-    rebuild(in, os);
+    _parsed = true;
 
     return true;
 }
 
-void codebook_library::rebuild(binary_istream& in, binary_ostream& out) {
-    auto dimensions = in.read<4>();
-    auto entries = in.read<14>();
-
-    out.write<8>('B')
-        .write<8>('C')
-        .write<8>('V')
-        .write<16>(dimensions)
-        .write<24>(entries);
-
-    auto ordered = in.read<1>();
-    out.write<1>(ordered);
-
-    if (ordered != 0) {
-        out.write<5>(in.read<5>()); // Initial
-
-        uintmax_t current = 0;
-        while (current < entries) {
-            auto bits = wwriff::ilog(static_cast<int>(entries - current));
-            auto number = in.read_bits(bits);
-            out.write_bits(number, bits);
-
-            current += number;
-        }
-
-        ASSERT(current <= entries);
-    } else {
-        auto codeword_length_length = in.read<3>();
-        auto sparse = in.read<1>();
-
-        ASSERT(codeword_length_length != 0 && codeword_length_length <= 5);
-
-        out.write<1>(sparse);
-
-        for (uint16_t i = 0; i < entries; ++i) {
-            if (sparse != 0) {
-                auto present = in.read<1>();
-                out.write<1>(present);
-
-                if (present == 0) {
-                    continue;
-                }
-            }
-
-            out.write<5>(in.read_bits(codeword_length_length) & 0b11111);
-        }
-    }
-
-    // Lookup
-    auto type = in.read<1>();
-    out.write<4>(type);
-
-    switch (type) {
-        case 0: break; // no lookup
-        case 1: {
-            out.write<32>(in.read<32>()) // min
-                .write<32>(in.read<32>()); // max
-
-            auto val_length = in.read<4>();
-            out.write<4>(val_length)
-                .write<1>(in.read<1>()); // Sequence flag
+bool wwriff_converter::convert(const ostream_ptr& out) {
+    CHECK(_parsed);
 
-            uint32_t quantvals = wwriff::book_maptype1_quantvals(entries, dimensions);
-            for (uint32_t i = 0; i < quantvals; ++i) {
-                auto val = in.read_bits(val_length + 1ui64);
-                out.write_bits(val, val_length + 1ui64);
-            }
+    ogg_stream os(out, 1);
+    vorbis_encoder vc;
 
-            break;
-        }
+    CHECK(_write_header(os, vc));
+    CHECK(_write_comment(os, vc));
+    CHECK(_write_setup(os, vc));
+    CHECK(_write_audio(os, vc));
 
-        case 2:
-        default: ASSERT(false);
-    }
+    return true;
+}
 
+const std::vector<wwriff_converter::packet_info>& wwriff_converter::packets() const {
+    return _packets;
+}
 
+long wwriff_converter::blocksize(const packet_info& packet) const {
+    return 1l << (packet.blockflag ? _blocksize_1_pow : _blocksize_0_pow);
 }
 
-wwriff_converter::wwriff_converter(const istream_ptr& in) : in { in } {
-    
+uint32_t wwriff_converter::channels() const {
+    return _channels;
 }
 
-bool wwriff_converter::parse() {
-    CHECK(_validate_header());
-    CHECK(_gather_chunks());
-    CHECK(_validate_chunks());
-    CHECK(_parse_chunks());
+uint32_t wwriff_converter::rate() const {
+    return _rate;
+}
 
-    _parsed = true;
+uint32_t wwriff_converter::bitrate() const {
+    return _bitrate;
+}
 
-    return true;
+int64_t wwriff_converter::header_sample_count() const {
+    return _header_sample_count;
 }
 
-bool wwriff_converter::convert(const ostream_ptr& out) {
-    CHECK(_parsed);
+int64_t wwriff_converter::sample_count() const {
+    int64_t samples = 0;
+    long last_bs = 0;
 
-    ogg_stream os(out, 1);
-    vorbis_encoder vc;
+    for (const packet_info& packet : _packets) {
+        long bs = blocksize(packet);
+        if (last_bs > 0) {
+            samples += (last_bs + bs) / 4;
+        }
 
-    CHECK(_write_header(os, vc));
-    CHECK(_write_comment(os, vc));
-    CHECK(_write_setup(os, vc));
-    CHECK(_write_audio(os, vc));
+        last_bs = bs;
+    }
 
-    return true;
+    return samples;
 }
 
 bool wwriff_converter::_validate_header() {
@@ -295,38 +220,40 @@ bool wwriff_converter::_validate_header() {
 }
 
 bool wwriff_converter::_gather_chunks() {
-    std::streamoff current_offset = in->tellg();
+    return with_cursor(*in, [this](auto& cursor) {
+        std::streamoff current_offset = cursor.tellg();
 
-    riff_header chunk;
-    while (current_offset < _riff_size) {
-        in->seekg(current_offset);
+        riff_header chunk;
+        while (current_offset < _riff_size) {
+            cursor.seekg(current_offset);
 
-        // Make sure there's space for the header
-        CHECK((current_offset + 8) <= _riff_size);
+            // Make sure there's space for the header
+            CHECK((current_offset + 8) <= _riff_size);
 
-        in->read(&chunk, sizeof(chunk));
-        CHECK(in->gcount() == sizeof(chunk));
+            cursor.read(&chunk, sizeof(chunk));
+            CHECK(cursor.gcount() == sizeof(chunk));
 
-        // Check all chunks
-        for (size_t i = 0; i < CHUNK_COUNT; ++i) {
-            if (std::string(chunk.header, 4) == chunk_map[i]) {
-                _chunks[i] = {
-                    .offset = current_offset + 8,
-                    .size = chunk.size
-                };
+            // Check all chunks
+            for (size_t i = 0; i < CHUNK_COUNT; ++i) {
+                if (std::string(chunk.header, 4) == chunk_map[i]) {
+                    _chunks[i] = {
+                        .offset = current_offset + 8,
+                        .size = chunk.size
+                    };
 
-                _chunks_found[i] = true;
-                break;
+                    _chunks_found[i] = true;
+                    break;
+                }
             }
-        }
 
-        // Advance by the size of the chunk
-        current_offset = current_offset + sizeof(chunk) + chunk.size;
-    }
+            // Advance by the size of the chunk
+            current_offset = current_offset + sizeof(chunk) + chunk.size;
+        }
 
-    CHECK(current_offset <= _riff_size);
+        CHECK(current_offset <= _riff_size);
 
-    return true;
+        return true;
+    });
 }
 
 bool wwriff_converter::_validate_chunks() {
@@ -436,6 +363,7 @@ bool wwriff_converter::_parse_vorb() {
     in->seekg(vorb.offset);
 
     uint32_t sample_count = in->read<uint32_t>();
+    _header_sample_count = sample_count;
 
     switch (vorb.size) {
         case 0:
@@ -499,9 +427,9 @@ bool wwriff_converter::_parse_vorb() {
     return true;
 }
 
-bool wwriff_converter::_write_header(ogg_stream& os, vorbis_encoder& vc) const {
-    auto ss = std::make_shared<std::stringstream>(std::ios::in | std::ios::out | std::ios::binary);
-    binary_ostream temp(ss);
+std::vector<char> wwriff_converter::identification_header() const {
+    memory_iostream packet_data;
+    binary_ostream& temp = packet_data;
 
     temp.write("\x01vorbis", 7);
 
@@ -519,9 +447,13 @@ bool wwriff_converter::_write_header(ogg_stream& os, vorbis_encoder& vc) const {
             .write<1>(1); // framing
     }
 
-    auto packet_data = ss->str();
+    return packet_data.release();
+}
+
+bool wwriff_converter::_write_header(ogg_stream& os, vorbis_encoder& vc) const {
+    std::vector<char> data = identification_header();
 
-    ogg_packet packet = os.packet(packet_data.data(), packet_data.size());
+    ogg_packet packet = os.packet(data.data(), data.size());
     os.packetin(packet);
     os.flush();
 
@@ -530,9 +462,9 @@ bool wwriff_converter::_write_header(ogg_stream& os, vorbis_encoder& vc) const {
     return true;
 }
 
-bool wwriff_converter::_write_comment(ogg_stream& os, vorbis_encoder& vc) const {
-    auto ss = std::make_shared<std::stringstream>(std::ios::in | std::ios::out | std::ios::binary);
-    binary_ostream temp(ss);
+std::vector<char> wwriff_converter::comment_header() const {
+    memory_iostream packet_data;
+    binary_ostream& temp = packet_data;
 
     temp.write("\x03vorbis", 7);
 
@@ -580,9 +512,13 @@ bool wwriff_converter::_write_comment(ogg_stream& os, vorbis_encoder& vc) const
         temp.write<1>(1); // Framing
     }
 
-    auto packet_data = ss->str();
+    return packet_data.release();
+}
+
+bool wwriff_converter::_write_comment(ogg_stream& os, vorbis_encoder& vc) const {
+    std::vector<char> data = comment_header();
 
-    ogg_packet packet = os.packet(packet_data.data(), packet_data.size());
+    ogg_packet packet = os.packet(data.data(), data.size());
     os.packetin(packet);
     os.pageout();
     
@@ -591,177 +527,322 @@ bool wwriff_converter::_write_comment(ogg_stream& os, vorbis_encoder& vc) const
     return true;
 }
 
-bool wwriff_converter::_write_setup(ogg_stream& os, vorbis_encoder& vc) {
-    auto ss = std::make_shared<std::stringstream>(std::ios::in | std::ios::out | std::ios::binary);
-    binary_ostream temp(ss);
+bool wwriff_converter::_rebuild_setup() {
+    memory_iostream packet_data;
+    binary_ostream& temp = packet_data;
 
     temp.write("\x05vorbis", 7);
 
     vorbis_packet setup_packet(in, _chunks[DATA].offset + _setup_offset, true);
+
+    // Read the entire packet at once and parse it from memory
+    std::vector<char> setup(setup_packet.size());
     in->seekg(setup_packet.this_offset());
+    in->read(setup);
+
+    CHECK(in->gcount() == setup_packet.size());
+    CHECK(setup_packet.next_offset() == (_chunks[DATA].offset + _audio_offset));
+
+    size_t key = detail::setup_key(setup, _channels);
+    if (auto cached = detail::find_setup(key, setup, _channels)) {
+        _setup_packet = cached->packet;
+        _mode_flag = cached->mode_flag;
+        _mode_bits = cached->mode_bits;
+
+        _codebook_count = cached->codebook_count;
+        _floor_count = cached->floor_count;
+        _residue_count = cached->residue_count;
+        _mapping_count = cached->mapping_count;
+
+        return true;
+    }
 
     {
-        bitwise_lock lock { in };
-        bitwise_lock lock2 { temp };
-        auto codebook_count_less1 = in->read<8>();
+        bit_reader packet { setup };
+        bitwise_lock lock { temp };
+        auto codebook_count_less1 = packet.read<8>();
 
         _codebook_count = codebook_count_less1 + 1;
         
         temp.write<8>(codebook_count_less1);
 
-        codebook_library cbl(std::make_shared<binary_istream>(IDR_PACKED_CODEBOOKS_AOTUV_603));
+        const rebuilt_codebook_library& cbl = detail::aotuv_603_codebooks();
 
         for (uint32_t i = 0; i < _codebook_count; ++i) {
-            CHECK(cbl.rebuild(in->read<10>(), temp));
+            CHECK(cbl.rebuild(packet.read<10>(), temp));
         }
 
         // Time domain transforms
         temp.write<6>(0);
         temp.write<16>(0);
 
-        CHECK(_write_floors(temp));
-        CHECK(_write_residue(temp));
-        CHECK(_write_mapping(temp));
-        CHECK(_write_mode(temp));
+        CHECK(_write_floors(packet, temp));
+        CHECK(_write_residue(packet, temp));
+        CHECK(_write_mapping(packet, temp));
+        CHECK(_write_mode(packet, temp));
 
         temp.write<1>(1); // framing
     }
 
-    auto packet_data = ss->str();
-
-    CHECK(setup_packet.next_offset() == (_chunks[DATA].offset + _audio_offset));
+    _setup_packet = packet_data.release();
 
-    ogg_packet packet = os.packet(packet_data.data(), packet_data.size());
-    os.packetin(packet);
-    os.flush();
-
-    CHECK(vc.headerin(packet));
+    detail::insert_setup(key, std::make_shared<detail::setup_header>(detail::setup_header {
+        .raw = std::move(setup),
+        .channels = _channels,
+        .packet = _setup_packet,
+        .mode_flag = _mode_flag,
+        .mode_bits = _mode_bits,
+        .codebook_count = _codebook_count,
+        .floor_count = _floor_count,
+        .residue_count = _residue_count,
+        .mapping_count = _mapping_count
+    }));
 
     return true;
 }
 
-bool wwriff_converter::_write_audio(ogg_stream& os, vorbis_encoder& vc) const {
-    auto offset = _chunks[DATA].offset + _audio_offset;
+bool wwriff_converter::_index_packets() {
+    const wwriff_chunk& data = _chunks[DATA];
+    const std::streamoff end = data.offset + data.size;
 
-    // Temporary buffer to hold packet data
-    std::vector<uint64_t> buf;
+    const uint8_t mode_mask = static_cast<uint8_t>((1u << _mode_bits) - 1);
 
-    long last_bs = 0;
-    int64_t granulepos = 0;
+    _packets.clear();
 
-    auto ss = std::make_shared<std::stringstream>(std::ios::in | std::ios::out | std::ios::binary);
-    binary_ostream temp(ss);
+    size_t skipped = 0;
 
-    const wwriff_chunk& data = _chunks[DATA];
+    // Only the size and first byte of every packet are needed
+    bool ok = with_cursor(*in, [&](auto& cursor) {
+        std::streamoff offset = data.offset + _audio_offset;
 
-    bool prev_flag = false;
+        while ((offset + 2) <= end) {
+            cursor.seekg(offset);
 
-    while (offset < (data.offset + data.size)) {
-        {
-            vorbis_packet packet { in, offset, true };
+            uint16_t size;
+            cursor.read(size);
+            if (cursor.gcount() != sizeof(size)) {
+                // The stream ends before the chunk does, so the last packet may be cut off as well
+                if (!_packets.empty()) {
+                    const packet_info& last = _packets.back();
 
-            CHECK((offset + packet.header_size()) <= (data.offset + data.size));
+                    uint8_t final_byte;
+                    cursor.seekg(last.offset + last.size - 1);
+                    cursor.read(final_byte);
+                    if (cursor.gcount() != sizeof(final_byte)) {
+                        nao::coutln("dropping truncated packet at", last.offset);
+                        _packets.pop_back();
+                    }
+                }
 
-            offset = packet.this_offset();
+                nao::coutln("audio data ends early at", offset);
+                break;
+            }
 
-            in->seekg(offset);
+            packet_info packet {
+                .offset = offset + 2,
+                .size = size
+            };
 
-            bitwise_lock lock { temp };
+            offset = packet.offset + size;
 
-            if (_mod_packets) {
-                CHECK(!_mode_flag.empty());
+            if ((packet.offset + size) > end) {
+                nao::coutln("dropping truncated packet at", packet.offset, "-", size, "bytes,", end - packet.offset, "available");
+                break;
+            }
 
-                temp.write<1>(0); // type audio
+            // Decoders skip empty packets, so leave them out of the index too
+            if (size == 0) {
+                ++skipped;
+                continue;
+            }
 
-                size_t remainder;
-                uintmax_t mode_number;
-                {
-                    bitwise_lock lock1 { in };
-                    mode_number = in->read_bits(_mode_bits);
-                    temp.write_bits(mode_number, _mode_bits);
+            uint8_t first;
+            cursor.read(first);
+            if (cursor.gcount() != sizeof(first)) {
+                nao::coutln("audio data ends early at", packet.offset);
+                break;
+            }
 
-                    remainder = in->read_bits(8 - _mode_bits);
+            if (_mod_packets) {
+                packet.mode = first & mode_mask;
+            } else {
+                // Regular audio packets have the type bit cleared, anything else is not audio
+                if ((first & 1) != 0) {
+                    ++skipped;
+                    continue;
                 }
 
-                if (_mode_flag[mode_number]) {
-                    std::streamoff next_offset = packet.next_offset();
-                    in->seekg(next_offset);
+                packet.mode = (first >> 1) & mode_mask;
+            }
 
-                    bool next_flag = false;
+            if (packet.mode >= _mode_flag.size()) {
+                ++skipped;
+                continue;
+            }
 
-                    if ((next_offset + packet.header_size()) <= (data.offset + data.size)) {
-                        vorbis_packet next_packet(in, next_offset, true);
+            packet.blockflag = _mode_flag[packet.mode];
 
-                        if (next_packet.size() > 0) {
-                            in->seekg(next_packet.this_offset());
+            _packets.push_back(packet);
+        }
 
-                            bitwise_lock lock1 { in };
+        return true;
+    });
 
-                            next_flag = _mode_flag[in->read_bits(_mode_bits)];
-                        }
-                    }
+    if (skipped > 0) {
+        nao::coutln("skipped", skipped, "empty or non-audio packets");
+    }
 
-                    temp.write<1>(prev_flag ? 1 : 0)
-                        .write<1>(next_flag ? 1 : 0);
+    return ok;
+}
 
-                    in->seekg(offset + 1);
-                }
+const std::vector<char>& wwriff_converter::setup_header() const {
+    return _setup_packet;
+}
 
-                prev_flag = _mode_flag[mode_number];
+bool wwriff_converter::_write_setup(ogg_stream& os, vorbis_encoder& vc) const {
+    // Packet data is not modified
+    ogg_packet packet = os.packet(const_cast<char*>(_setup_packet.data()), _setup_packet.size());
+    os.packetin(packet);
+    os.flush();
 
-                temp.write_bits(remainder, 8 - _mode_bits);
-            } else {
-                temp.write<8>(in->read<uint8_t>());
-            }
+    CHECK(vc.headerin(packet));
+
+    return true;
+}
+
+bool wwriff_converter::rewrite(packet_range& range) const {
+    const packet_info& first = _packets[range.first];
+    const packet_info& last = _packets[range.last - 1];
+
+    // Packets are contiguous, read the whole range including size headers at once
+    std::streamoff start = first.offset - 2;
+
+    std::vector<char> buf(static_cast<size_t>((last.offset + last.size) - start));
+    std::streamsize bytes = in->read_at(start, buf);
+    if (bytes != static_cast<std::streamsize>(buf.size())) {
+        nao::coutln("packets", range.first, "to", range.last, "truncated, read", std::max<std::streamsize>(bytes, 0), "of", buf.size(), "bytes");
+        return false;
+    }
 
-            size_t bytes = packet.size() - 1;
-            buf.resize((bytes + (sizeof(uint64_t) - 1)) / sizeof(uint64_t));
+    memory_iostream packet_data;
+    binary_ostream& temp = packet_data;
 
-            in->read(buf.data(), bytes);
+    range.ends.reserve(range.last - range.first);
+    range.granules.reserve(range.last - range.first);
 
-            for (uint64_t c : buf) {
-                if (bytes >= sizeof(uint64_t)) {
-                    // At least 1 full value left
-                    temp.write<sizeof(uint64_t) * CHAR_BIT>(c);
-                    bytes -= sizeof(uint64_t);
-                } else {
-                    temp.write_bits(c, bytes * CHAR_BIT);
+    int64_t granulepos = 0;
+
+    for (size_t i = range.first; i < range.last; ++i) {
+        const packet_info& packet = _packets[i];
+
+        const char* payload = buf.data() + (packet.offset - start);
+
+        {
+            bitwise_lock lock { temp };
+
+            if (_mod_packets) {
+                temp.write<1>(0); // type audio
+
+                temp.write_bits(packet.mode, _mode_bits);
+
+                if (packet.blockflag) {
+                    bool prev_flag = (i > 0) && _packets[i - 1].blockflag;
+                    bool next_flag = ((i + 1) < _packets.size()) && _packets[i + 1].blockflag;
+
+                    temp.write<1>(prev_flag ? 1 : 0)
+                        .write<1>(next_flag ? 1 : 0);
                 }
 
+                temp.write_bits(static_cast<uint8_t>(payload[0]) >> _mode_bits, 8 - _mode_bits);
+            } else {
+                temp.write<8>(static_cast<uint8_t>(payload[0]));
             }
 
-            offset = packet.next_offset();
+            // Payload is appended at whatever bit offset the mode bits left us at
+            temp.append_bytes(payload + 1, packet.size - 1);
         }
 
-        auto packet_data = ss->str();
-
-        ogg_packet packet = os.packet(packet_data.data(), packet_data.size());
-        long bs = vc.blocksize(packet);
+        range.ends.push_back(packet_data.size());
 
-        CHECK(bs > 0);
-        if (last_bs > 0) {
-            granulepos += (last_bs + bs) / 4;
+        // Local part of the granule prefix sum, the very first packet has no preceding block
+        if (i > 0) {
+            granulepos += (blocksize(_packets[i - 1]) + blocksize(packet)) / 4;
         }
 
-        last_bs = bs;
-        packet.granulepos = granulepos;
+        range.granules.push_back(granulepos);
+    }
+
+    range.data = packet_data.release();
+
+    return true;
+}
 
-        if (offset >= (data.offset + data.size)) {
-            packet.e_o_s = 1;
+bool wwriff_converter::_write_audio(ogg_stream& os, vorbis_encoder&) const {
+    if (_packets.empty()) {
+        return true;
+    }
+
+    size_t range_count = std::clamp<size_t>(
+        _packets.size() / detail::min_packets_per_range, 1, std::max<size_t>(thread_pool::pool_size(), 1));
+
+    std::vector<packet_range> ranges(range_count);
+    for (size_t i = 0; i < range_count; ++i) {
+        ranges[i].first = (_packets.size() * i) / range_count;
+        ranges[i].last = (_packets.size() * (i + 1)) / range_count;
+    }
+
+    if (range_count == 1) {
+        ranges.front().ok = rewrite(ranges.front());
+    } else {
+        std::latch done { static_cast<ptrdiff_t>(range_count) };
+
+        for (packet_range& range : ranges) {
+            thread_pool::shared().push([this, &range, &done] {
+                try {
+                    range.ok = rewrite(range);
+                } catch (const std::exception& e) {
+                    nao::coutln("failed to rewrite packets:", e.what());
+                    range.ok = false;
+                }
+
+                done.count_down();
+            });
         }
 
-        os.packetin(packet);
-        os.pageout();
+        done.wait();
+    }
+
+    // Page boundaries depend on every preceding packet, so packets are submitted in order
+    int64_t granule_base = 0;
+
+    for (packet_range& range : ranges) {
+        CHECK(range.ok);
+
+        size_t start = 0;
+        for (size_t i = 0; i < range.ends.size(); ++i) {
+            ogg_packet packet = os.packet(range.data.data() + start, range.ends[i] - start);
+            packet.granulepos = granule_base + range.granules[i];
+
+            if ((range.first + i + 1) == _packets.size()) {
+                packet.e_o_s = 1;
+            }
+
+            os.packetin(packet);
+            os.pageout();
+
+            start = range.ends[i];
+        }
 
-        ss->str("");
+        // Each range's first granule already includes the overlap with the preceding range
+        granule_base += range.granules.back();
     }
 
     return true;
 }
 
-bool wwriff_converter::_write_floors(binary_ostream& out) {
+bool wwriff_converter::_write_floors(bit_reader& packet, binary_ostream& out) {
     // Floors
-    auto floor_count_less1 = in->read<6>();
+    auto floor_count_less1 = packet.read<6>();
 
     _floor_count = floor_count_less1 + 1;
 
@@ -770,13 +851,13 @@ bool wwriff_converter::_write_floors(binary_ostream& out) {
     for (uint32_t i = 0; i < _floor_count; ++i) {
         out.write<16>(1);
 
-        auto floor1_partitions = in->read<5>();
+        auto floor1_partitions = packet.read<5>();
         out.write<5>(floor1_partitions);
 
         std::vector<uint8_t> floor1_partition_class_list(floor1_partitions);
         uint8_t max_class = 0;
         for (uint8_t j = 0; j < floor1_partitions; ++j) {
-            auto floor1_partition_class = in->read<4>();
+            auto floor1_partition_class = packet.read<4>();
             out.write<4>(floor1_partition_class);
 
             floor1_partition_class_list[j] = floor1_partition_class;
@@ -788,23 +869,23 @@ bool wwriff_converter::_write_floors(binary_ostream& out) {
 
         std::vector<uint8_t> floor1_class_dimension_list(max_class + 1ui64);
         for (uint8_t j = 0; j <= max_class; ++j) {
-            auto class_dimension_less1 = in->read<3>();
+            auto class_dimension_less1 = packet.read<3>();
             out.write<3>(class_dimension_less1);
 
             floor1_class_dimension_list[j] = class_dimension_less1 + 1;
 
-            auto subclasses = in->read<2>();
+            auto subclasses = packet.read<2>();
             out.write<2>(subclasses);
 
             if (subclasses != 0) {
-                auto master_book = in->read<8>();
+                auto master_book = packet.read<8>();
                 out.write<8>(master_book);
 
                 CHECK(master_book < _codebook_count);
             }
 
             for (uint8_t k = 0; k < (1ui8 << subclasses); ++k) {
-                auto subclass_book_plus1 = in->read<8>();
+                auto subclass_book_plus1 = packet.read<8>();
                 out.write<8>(subclass_book_plus1);
 
                 int16_t subclass_book = static_cast<int16_t>(subclass_book_plus1) - 1;
@@ -814,14 +895,14 @@ bool wwriff_converter::_write_floors(binary_ostream& out) {
             }
         }
 
-        out.write<2>(in->read<2>()); // floor1_multiplier_less1
+        out.write<2>(packet.read<2>()); // floor1_multiplier_less1
 
-        auto rangebits = in->read<4>();
+        auto rangebits = packet.read<4>();
         out.write<4>(rangebits);
 
         for (uint8_t j = 0; j < floor1_partitions; ++j) {
             for (uint8_t k = 0; k < floor1_class_dimension_list[floor1_partition_class_list[j]]; ++k) {
-                out.write_bits(in->read_bits(rangebits), rangebits);
+                out.write_bits(packet.read_bits(rangebits), rangebits);
             }
         }
     }
@@ -829,24 +910,24 @@ bool wwriff_converter::_write_floors(binary_ostream& out) {
     return true;
 }
 
-bool wwriff_converter::_write_residue(binary_ostream& out) {
+bool wwriff_converter::_write_residue(bit_reader& packet, binary_ostream& out) {
     // Residue
-    auto residue_count_less1 = in->read<6>();
+    auto residue_count_less1 = packet.read<6>();
     out.write<6>(residue_count_less1);
 
     _residue_count = residue_count_less1 + 1;
 
     for (uint32_t i = 0; i < _residue_count; ++i) {
-        auto type = in->read<2>();
+        auto type = packet.read<2>();
         out.write<16>(type);
 
         CHECK(type <= 2);
 
-        auto begin = in->read<24>();
-        auto end = in->read<24>();
-        auto residue_partition_size_less1 = in->read<24>();
-        auto residue_classifications_less1 = in->read<6>();
-        auto residue_classbook = in->read<8>();
+        auto begin = packet.read<24>();
+        auto end = packet.read<24>();
+        auto residue_partition_size_less1 = packet.read<24>();
+        auto residue_classifications_less1 = packet.read<6>();
+        auto residue_classbook = packet.read<8>();
 
         uint8_t residue_classifications = residue_classifications_less1 + 1;
 
@@ -861,16 +942,16 @@ bool wwriff_converter::_write_residue(binary_ostream& out) {
         std::vector<uint16_t> cascade(residue_classifications);
 
         for (uint8_t j = 0; j < residue_classifications; ++j) {
-            auto low_bits = in->read<3>();
+            auto low_bits = packet.read<3>();
             out.write<3>(low_bits);
 
             cascade[j] = low_bits;
 
-            auto flag = in->read<1>();
+            auto flag = packet.read<1>();
             out.write<1>(flag);
 
             if (flag != 0) {
-                auto high_bits = in->read<5>();
+                auto high_bits = packet.read<5>();
                 out.write<5>(high_bits);
                 cascade[j] |= (high_bits << 3);
             }
@@ -879,7 +960,7 @@ bool wwriff_converter::_write_residue(binary_ostream& out) {
         for (uint8_t j = 0; j < residue_classifications; ++j) {
             for (uint8_t k = 0; k < 8; ++k) {
                 if (cascade[j] & (1 << k)) {
-                    auto book = in->read<8>();
+                    auto book = packet.read<8>();
                     out.write<8>(book);
 
                     CHECK(book < _codebook_count);
@@ -891,9 +972,9 @@ bool wwriff_converter::_write_residue(binary_ostream& out) {
     return true;
 }
 
-bool wwriff_converter::_write_mapping(binary_ostream& out) {
+bool wwriff_converter::_write_mapping(bit_reader& packet, binary_ostream& out) {
     // Mapping
-    auto mapping_count_less1 = in->read<6>();
+    auto mapping_count_less1 = packet.read<6>();
     out.write<6>(mapping_count_less1);
 
     _mapping_count = mapping_count_less1 + 1;
@@ -901,30 +982,30 @@ bool wwriff_converter::_write_mapping(binary_ostream& out) {
     for (uint32_t i = 0; i < _mapping_count; ++i) {
         out.write<16>(0); // mapping type
 
-        auto flag = in->read<1>();
+        auto flag = packet.read<1>();
         out.write<1>(flag);
 
         uint8_t submaps = 1;
         if (flag != 0) {
-            auto submaps_less1 = in->read<4>();
+            auto submaps_less1 = packet.read<4>();
             out.write<4>(submaps_less1);
 
             submaps = submaps_less1 + 1;
         }
 
-        auto square_polar_flag = in->read<1>();
+        auto square_polar_flag = packet.read<1>();
         out.write<1>(square_polar_flag);
 
         if (square_polar_flag != 0) {
-            auto coupling_steps_less1 = in->read<8>();
+            auto coupling_steps_less1 = packet.read<8>();
             out.write<8>(coupling_steps_less1);
 
             uint16_t coupling_steps = coupling_steps_less1 + 1;
 
             for (uint16_t j = 0; j < coupling_steps; ++j) {
                 const auto bits = wwriff::ilog(_channels - 1);
-                auto magnitude = in->read_bits(bits);
-                auto angle = in->read_bits(bits);
+                auto magnitude = packet.read_bits(bits);
+                auto angle = packet.read_bits(bits);
 
                 out.write_bits(magnitude, bits)
                     .write_bits(angle, bits);
@@ -932,13 +1013,13 @@ bool wwriff_converter::_write_mapping(binary_ostream& out) {
             }
         }
 
-        auto reserved = in->read<2>();
+        auto reserved = packet.read<2>();
         out.write<2>(reserved);
         CHECK(reserved == 0);
 
         if (submaps > 1) {
             for (uint32_t j = 0; j < _channels; ++j) {
-                auto mux = in->read<4>();
+                auto mux = packet.read<4>();
                 out.write<4>(mux);
 
                 CHECK(mux < submaps);
@@ -946,14 +1027,14 @@ bool wwriff_converter::_write_mapping(binary_ostream& out) {
         }
 
         for (uint16_t j = 0; j < submaps; ++j) {
-            out.write<8>(in->read<8>()); // config
+            out.write<8>(packet.read<8>()); // config
 
-            auto floor_number = in->read<8>();
+            auto floor_number = packet.read<8>();
             out.write<8>(floor_number);
 
             CHECK(floor_number < _floor_count);
 
-            auto residue_number = in->read<8>();
+            auto residue_number = packet.read<8>();
             out.write<8>(residue_number);
 
             CHECK(residue_number < _residue_count);
@@ -963,8 +1044,8 @@ bool wwriff_converter::_write_mapping(binary_ostream& out) {
     return true;
 }
 
-bool wwriff_converter::_write_mode(binary_ostream& out) {
-    auto mode_count_less1 = in->read<6>();
+bool wwriff_converter::_write_mode(bit_reader& packet, binary_ostream& out) {
+    auto mode_count_less1 = packet.read<6>();
     out.write<6>(mode_count_less1);
 
     uint8_t mode_count = mode_count_less1 + 1;
@@ -973,7 +1054,7 @@ bool wwriff_converter::_write_mode(binary_ostream& out) {
     _mode_bits = wwriff::ilog(mode_count - 1);
 
     for (uint8_t i = 0; i < mode_count; ++i) {
-        auto flag = in->read<1>();
+        auto flag = packet.read<1>();
         out.write<1>(flag);
 
         _mode_flag[i] = flag != 0;
@@ -981,7 +1062,7 @@ bool wwriff_converter::_write_mode(binary_ostream& out) {
         out.write<16>(0) // window type
             .write<16>(0); // transform type
 
-        auto mapping = in->read<8>();
+        auto mapping = packet.read<8>();
         out.write<8>(mapping);
 
         CHECK(mapping < _mapping_count);
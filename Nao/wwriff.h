@@ -1,12 +1,10 @@
 #pragma once
 
 #include "binary_stream.h"
+#include "bit_reader.h"
+#include "codebook_library.h"
 
 namespace wwriff {
-    // Taken from libvorbis
-    int ilog(unsigned int v);
-    long book_maptype1_quantvals(long entries, long dim);
-
     // Convert a Wwise RIFF file to a valid ogg file
     bool wwriff_to_ogg(const istream_ptr& in, const ostream_ptr& out);
 }
@@ -30,27 +28,6 @@ class vorbis_packet {
     bool _m_no_granule { };
 };
 
-
-class codebook_library {
-    public:
-    explicit codebook_library(const istream_ptr& codebook);
-
-    const char* get_codebook(uint32_t id) const;
-    std::streamsize get_size(uint32_t id) const;
-
-    bool rebuild(uint32_t id, binary_ostream& os) const;
-
-    static void rebuild(binary_istream& in, binary_ostream& out);
-
-    protected:
-    istream_ptr stream;
-
-    private:
-    std::vector<char> _m_data;
-    std::vector<uint32_t> _m_offsets;
-    uint32_t _m_codebook_count;
-};
-
 class ogg_stream;
 class vorbis_encoder;
 
@@ -81,6 +58,8 @@ class wwriff_converter {
     uint32_t _rate { };
     uint32_t _bitrate { };
 
+    uint32_t _header_sample_count { };
+
     uint8_t _blocksize_0_pow { };
     uint8_t _blocksize_1_pow { };
 
@@ -93,14 +72,69 @@ class wwriff_converter {
     std::vector<bool> _mode_flag;
     size_t _mode_bits { };
 
+    // Rebuilt setup header packet
+    std::vector<char> _setup_packet;
+
     bool _parsed { };
 
     public:
+    // Audio packet in the DATA chunk
+    struct packet_info {
+        std::streamoff offset; // Start of the packet data, past the size header
+        uint16_t size;
+        uint8_t mode;
+        bool blockflag;
+    };
+
     wwriff_converter(const istream_ptr& in);
 
     bool parse();
     bool convert(const ostream_ptr& out);
 
+    // Parse only the RIFF chunks, without rebuilding the setup header or indexing packets
+    bool parse_info();
+
+    // Stream info, available after parse_info()
+    uint32_t channels() const;
+    uint32_t rate() const;
+    uint32_t bitrate() const;
+
+    // Sample count stored in the vorb chunk, which matches the last packet's granule
+    int64_t header_sample_count() const;
+
+    // Index of all audio packets, available after parse()
+    const std::vector<packet_info>& packets() const;
+
+    // Block size of an audio packet in samples
+    long blocksize(const packet_info& packet) const;
+
+    // Total number of samples per channel, equal to the final granule position
+    int64_t sample_count() const;
+
+    // Rebuilt Vorbis header packets
+    std::vector<char> identification_header() const;
+    std::vector<char> comment_header() const;
+    const std::vector<char>& setup_header() const;
+
+    // Consecutive audio packets rewritten as standard Vorbis packets
+    struct packet_range {
+        // Packet indices, [first, last)
+        size_t first;
+        size_t last;
+
+        // Rewritten packets, back to back
+        std::vector<char> data;
+        std::vector<size_t> ends;
+
+        // Granule positions relative to the start of the range
+        std::vector<int64_t> granules;
+
+        bool ok;
+    };
+
+    // Rewrite packets [range.first, range.last), safe to call concurrently
+    bool rewrite(packet_range& range) const;
+
     private:
     bool _validate_header();
     bool _gather_chunks();
@@ -110,20 +144,24 @@ class wwriff_converter {
     bool _parse_cue();
     bool _parse_smpl();
     bool _parse_vorb();
+    bool _rebuild_setup();
+    bool _index_packets();
 
     bool _write_header(ogg_stream& os, vorbis_encoder& vc) const;
     bool _write_comment(ogg_stream& os, vorbis_encoder& vc) const;
-    bool _write_setup(ogg_stream& os, vorbis_encoder& vc);
+    bool _write_setup(ogg_stream& os, vorbis_encoder& vc) const;
     bool _write_audio(ogg_stream& os, vorbis_encoder& vc) const;
 
-    bool _write_floors(binary_ostream& out);
-    bool _write_residue(binary_ostream& out);
-    bool _write_mapping(binary_ostream& out);
-    bool _write_mode(binary_ostream& out);
+    bool _write_floors(bit_reader& packet, binary_ostream& out);
+    bool _write_residue(bit_reader& packet, binary_ostream& out);
+    bool _write_mapping(bit_reader& packet, binary_ostream& out);
+    bool _write_mode(bit_reader& packet, binary_ostream& out);
 
     protected:
     istream_ptr in;
 
     private:
+    std::vector<packet_info> _packets;
+
     static std::string chunk_map[CHUNK_COUNT];
 };
\ No newline at end of file
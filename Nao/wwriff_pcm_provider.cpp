@@ -0,0 +1,220 @@
+#include "wwriff_pcm_provider.h"
+
+#include "utils.h"
+
+#include <algorithm>
+
+extern "C" {
+#include <libavutil/channel_layout.h>
+}
+
+namespace detail {
+    // Vorbis channel order differs from avutil's, same mapping as FFmpeg's Vorbis decoder
+    static constexpr uint8_t channel_offsets[8][8] = {
+        { 0 },
+        { 0, 1 },
+        { 0, 2, 1 },
+        { 0, 1, 2, 3 },
+        { 0, 2, 1, 3, 4 },
+        { 0, 2, 1, 5, 3, 4 },
+        { 0, 2, 1, 6, 5, 3, 4 },
+        { 0, 2, 1, 7, 5, 6, 3, 4 },
+    };
+
+    static constexpr uint64_t channel_layouts[8] = {
+        AV_CH_LAYOUT_MONO,
+        AV_CH_LAYOUT_STEREO,
+        AV_CH_LAYOUT_SURROUND,
+        AV_CH_LAYOUT_QUAD,
+        AV_CH_LAYOUT_5POINT0_BACK,
+        AV_CH_LAYOUT_5POINT1_BACK,
+        AV_CH_LAYOUT_6POINT1,
+        AV_CH_LAYOUT_7POINT1,
+    };
+
+    static ogg_packet make_packet(const char* data, size_t size, int64_t packetno) {
+        return {
+            .packet = reinterpret_cast<unsigned char*>(const_cast<char*>(data)),
+            .bytes = static_cast<long>(size),
+            .b_o_s = (packetno == 0) ? 1 : 0,
+            .e_o_s = 0,
+            .granulepos = -1,
+            .packetno = packetno
+        };
+    }
+}
+
+wwriff_pcm_provider::wwriff_pcm_provider(const istream_ptr& stream) : pcm_provider(stream), _converter { stream } {
+    if (!_converter.parse()) {
+        throw std::runtime_error("invalid Wwise RIFF file");
+    }
+
+    vorbis_info_init(&_vi);
+    vorbis_comment_init(&_vc);
+
+    std::vector<char> headers[] {
+        _converter.identification_header(),
+        _converter.comment_header(),
+        _converter.setup_header()
+    };
+
+    for (int64_t i = 0; i < 3; ++i) {
+        ogg_packet packet = detail::make_packet(headers[i].data(), headers[i].size(), i);
+        if (vorbis_synthesis_headerin(&_vi, &_vc, &packet) != 0) {
+            vorbis_comment_clear(&_vc);
+            vorbis_info_clear(&_vi);
+            throw std::runtime_error("invalid Vorbis header");
+        }
+    }
+
+    vorbis_synthesis_init(&_vd, &_vi);
+    vorbis_block_init(&_vd, &_vb);
+
+    _channels = utils::narrow<uint8_t>(_vi.channels);
+    _channel_layout = (_channels <= 8)
+        ? detail::channel_layouts[_channels - 1] : static_cast<uint64_t>(av_get_default_channel_layout(_channels));
+
+    const auto& packets = _converter.packets();
+    _granules.resize(packets.size());
+
+    int64_t granule = 0;
+    for (size_t i = 0; i < packets.size(); ++i) {
+        if (i > 0) {
+            granule += (_converter.blocksize(packets[i - 1]) + _converter.blocksize(packets[i])) / 4;
+        }
+
+        _granules[i] = granule;
+    }
+}
+
+wwriff_pcm_provider::~wwriff_pcm_provider() {
+    vorbis_block_clear(&_vb);
+    vorbis_dsp_clear(&_vd);
+    vorbis_comment_clear(&_vc);
+    vorbis_info_clear(&_vi);
+}
+
+pcm_samples wwriff_pcm_provider::get_samples() {
+    float** pcm;
+    int frames;
+
+    for (;;) {
+        frames = vorbis_synthesis_pcmout(&_vd, &pcm);
+
+        // Drop pre-roll after a seek
+        if (frames > 0 && _skip > 0) {
+            int skipped = static_cast<int>(std::min<int64_t>(frames, _skip));
+            vorbis_synthesis_read(&_vd, skipped);
+            _skip -= skipped;
+            continue;
+        }
+
+        if (frames > 0) {
+            break;
+        }
+
+        if (!_decode_packet()) {
+            // EOF
+            return { format(), 0, _channels, _channel_layout };
+        }
+    }
+
+    // Planar output, copied one channel at a time
+    pcm_samples samples { format(), static_cast<uint64_t>(frames), _channels, _channel_layout };
+    float* dest = samples.data<sample_format::float32p>();
+
+    for (uint8_t i = 0; i < _channels; ++i) {
+        uint8_t source = (_channels <= 8) ? detail::channel_offsets[_channels - 1][i] : i;
+        std::copy_n(pcm[source], frames, dest + (static_cast<size_t>(i) * frames));
+    }
+
+    vorbis_synthesis_read(&_vd, frames);
+    _samples_played += frames;
+
+    return samples;
+}
+
+int64_t wwriff_pcm_provider::rate() {
+    return _vi.rate;
+}
+
+int64_t wwriff_pcm_provider::channels() {
+    return _channels;
+}
+
+std::string wwriff_pcm_provider::name() {
+    return "Wwise Vorbis";
+}
+
+std::chrono::nanoseconds wwriff_pcm_provider::duration() {
+    if (_granules.empty()) {
+        return std::chrono::nanoseconds { 0 };
+    }
+
+    return std::chrono::nanoseconds { (_granules.back() * 1'000'000'000) / _vi.rate };
+}
+
+std::chrono::nanoseconds wwriff_pcm_provider::pos() {
+    return std::chrono::nanoseconds { (_samples_played * 1'000'000'000) / _vi.rate };
+}
+
+void wwriff_pcm_provider::seek(std::chrono::nanoseconds pos) {
+    int64_t target = (pos.count() * _vi.rate) / 1'000'000'000;
+    target = std::clamp<int64_t>(target, 0, _granules.empty() ? 0 : _granules.back());
+
+    // First packet that ends after the target, decoding starts one packet earlier for the overlap
+    auto it = std::upper_bound(_granules.begin(), _granules.end(), target);
+    size_t packet = std::distance(_granules.begin(), it);
+    if (packet > 0) {
+        --packet;
+    }
+
+    vorbis_synthesis_restart(&_vd);
+
+    // The pre-roll packet produces no output, samples before the target are skipped
+    int64_t start = _granules.empty() ? 0 : _granules[std::min(packet, _granules.size() - 1)];
+
+    _next_packet = packet;
+    _skip = target - start;
+    _samples_played = target;
+}
+
+sample_format wwriff_pcm_provider::format() {
+    return sample_format::float32p;
+}
+
+bool wwriff_pcm_provider::_decode_packet() {
+    const auto& packets = _converter.packets();
+
+    if (_next_packet >= packets.size()) {
+        return false;
+    }
+
+    // Rewrite the next batch once all previous packets were decoded
+    if (_next_packet < _batch.first || _next_packet >= _batch.last) {
+        _batch = {
+            .first = _next_packet,
+            .last = std::min(_next_packet + batch_size, packets.size())
+        };
+
+        if (!_converter.rewrite(_batch)) {
+            throw pcm_decode_exception("failed to rewrite packets");
+        }
+    }
+
+    size_t index = _next_packet - _batch.first;
+    size_t begin = (index > 0) ? _batch.ends[index - 1] : 0;
+
+    // Header packets come first
+    ogg_packet packet = detail::make_packet(_batch.data.data() + begin, _batch.ends[index] - begin, _next_packet + 3);
+    packet.e_o_s = ((_next_packet + 1) == packets.size()) ? 1 : 0;
+
+    ++_next_packet;
+
+    // Undecodable packets are skipped, like a demuxer would
+    if (vorbis_synthesis(&_vb, &packet) == 0) {
+        vorbis_synthesis_blockin(&_vd, &_vb);
+    }
+
+    return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "pcm_provider.h"
+#include "wwriff.h"
+
+#include <vorbis/codec.h>
+
+// Decodes Wwise Vorbis by feeding rebuilt packets straight to libvorbis, without an Ogg stream or demuxer
+class wwriff_pcm_provider : public pcm_provider {
+    // Audio packets rewritten at a time
+    static constexpr size_t batch_size = 64;
+
+    wwriff_converter _converter;
+
+    vorbis_info _vi;
+    vorbis_comment _vc;
+    vorbis_dsp_state _vd;
+    vorbis_block _vb;
+
+    // Seek table, granule position after every audio packet
+    std::vector<int64_t> _granules;
+
+    // Rewritten packets that were not decoded yet
+    wwriff_converter::packet_range _batch { };
+    size_t _next_packet = 0;
+
+    int64_t _samples_played = 0;
+
+    // Decoded samples to discard to land exactly on a seek target
+    int64_t _skip = 0;
+
+    uint8_t _channels;
+    uint64_t _channel_layout;
+
+    public:
+    explicit wwriff_pcm_provider(const istream_ptr& stream);
+    ~wwriff_pcm_provider() override;
+
+    pcm_samples get_samples() override;
+    int64_t rate() override;
+    int64_t channels() override;
+    std::string name() override;
+
+    std::chrono::nanoseconds duration() override;
+    std::chrono::nanoseconds pos() override;
+    void seek(std::chrono::nanoseconds pos) override;
+
+    sample_format format() override;
+
+    private:
+    // Decode the next audio packet, false if there are no more
+    bool _decode_packet();
+};
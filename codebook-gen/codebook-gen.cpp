@@ -0,0 +1,47 @@
+// Expands the packed Wwise codebooks into complete Vorbis codebooks at build time.
+// The output is loaded by rebuilt_codebook_library.
+
+#include "codebook_library.h"
+
+#include <iostream>
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::cerr << "usage: codebook-gen <packed codebooks> <output>\n";
+        return 1;
+    }
+
+    codebook_library library(std::make_shared<binary_istream>(std::filesystem::path(argv[1])));
+
+    // { offset, bits } per codebook
+    std::vector<uint32_t> table;
+    std::vector<char> data;
+
+    for (uint32_t i = 0; i < library.count(); ++i) {
+        memory_iostream codebook;
+        binary_ostream& out = codebook;
+
+        size_t bits = 0;
+
+        {
+            bitwise_lock lock { out };
+            if (library.rebuild(i, out)) {
+                bits = (codebook.size() * CHAR_BIT) + out.pending_bits();
+            }
+        }
+
+        table.push_back(static_cast<uint32_t>(data.size()));
+        table.push_back(static_cast<uint32_t>(bits));
+
+        data.insert(data.end(), codebook.data(), codebook.data() + ((bits + 7) / 8));
+    }
+
+    binary_ostream output(std::filesystem::path { argv[2] });
+    output.write(library.count());
+    output.write(table);
+    output.write(data);
+
+    std::cout << "Rebuilt " << library.count() << " codebooks, " << data.size() << " bytes\n";
+
+    return 0;
+}